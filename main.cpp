@@ -6,20 +6,53 @@
 
 // System Libraries Here
 #include <iostream>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <list>
 #include <map>
-#include <set>
-#include <stack>
-#include <queue>
+#include <unordered_map>
 #include <algorithm>
-#include <numeric>
 #include <random>
 #include <chrono>
 #include <stdexcept>
 #include <limits>
 #include <sstream>
 #include <iomanip> // For output formatting
+#include <vector>
+#include <type_traits>
+#include <charconv>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BJSIMD 1 // x86 settlement kernels, built per function with target attributes
+#include <immintrin.h>
+#endif
+#if defined(__linux__)
+#define BJNET 1 // Game server on epoll and non-blocking sockets
+#include <cerrno>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#define BJMMAP 1 // Replay files are read through mmap
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 // User Libraries Here
 // Global Constants Only, No Global Variables
@@ -27,48 +60,151 @@
 
 // Card Structure and Constants
 
+// Number of ranks and suits in a standard deck
+const int NRANKS = 13;
+const int NSUITS = 4;
+
+// Rank display strings, indexed by rank code (0 = Ace ... 12 = King)
+const char* const RNKSTR[NRANKS] = {
+    "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K"
+};
+// Suit display strings, indexed by suit code
+// "\u2660" (Spades), "\u2665" (Hearts), "\u2666" (Diamonds), "\u2663" (Clubs)
+const char* const SUITSTR[NSUITS] = {"\u2660", "\u2665", "\u2666", "\u2663"};
+
+// Primary value per rank code (Ace is 11 by default; adjusted in scoring logic)
+const uint8_t RNKVAL[NRANKS] = {11, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10, 10};
+// Hard value per rank code (Ace counts 1), used by scoring
+const uint8_t RNKHRD[NRANKS] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 10, 10, 10};
+
 // Card Structure
+// Packed into one byte: code = rank * 4 + suit
 struct Card {
-    std::string rank; // "A", "2", ..., "K"
-    std::string suit; // "\u2660" (Spades), "\u2665" (Hearts), "\u2666" (Diamonds), "\u2663" (Clubs)
-    int value; // Primary value (Ace = 11)
+    uint8_t code = 0; // Rank code in the high bits, suit code in the low 2 bits
+
+    Card() = default;
+    Card(int rnk, int st) : code(static_cast<uint8_t>(rnk * NSUITS + st)) {}
+
+    int rank() const { return code >> 2; } // 0 = Ace ... 12 = King
+    int suit() const { return code & 3; } // Index into SUITSTR
+    int value() const { return RNKVAL[code >> 2]; } // Primary value (Ace = 11)
+    int hard() const { return RNKHRD[code >> 2]; } // Hard value (Ace = 1)
+    bool isAce() const { return code < NSUITS; } // Aces occupy codes 0-3
 
     // Overloaded operators for list/set comparisons and unique checks
     // Required for std::find and comparisons
     bool operator==(const Card& oth) const {
         // Two cards are equal if both rank and suit match
-        return rank == oth.rank && suit == oth.suit;
+        return code == oth.code;
     }
     bool operator<(const Card& oth) const { // For sorting
-        if (rank != oth.rank) return rank < oth.rank; // Sort by rank first
-        return suit < oth.suit; // Then by suit
+        return code < oth.code; // Sort by rank first, then by suit
     }
-    // For easy printing
+    // For easy printing; the only place rank/suit strings are used
     friend std::ostream& operator<<(std::ostream& os, const Card& c) {
-        return os << c.rank << c.suit; // e.g., "A♠"
+        return os << RNKSTR[c.rank()] << SUITSTR[c.suit()]; // e.g., "A♠"
     }
 };
+static_assert(sizeof(Card) == 1, "Card must pack into a single byte");
 
-// Map: Stores rank to its primary value
-const std::map<std::string, int> CRDVALS = {
-    // Ace is 11 by default; adjusted in scoring logic
-    {"A", 11}, {"2", 2}, {"3", 3}, {"4", 4}, {"5", 5}, {"6", 6},
-    {"7", 7}, {"8", 8}, {"9", 9}, {"10", 10}, {"J", 10}, {"Q", 10}, {"K", 10}
-};
-// List: Stores all suits
-const std::list<std::string> SUITS = {"\u2660", "\u2665", "\u2666", "\u2663"};
+// Fixed-Capacity Inline Vector
+// std::vector-like container whose storage lives inside the object, for
+// collections with a small known upper bound; it never touches the heap
+template <typename T, int N>
+struct InlVec {
+    T items[N]; // Inline storage
+    int cnt = 0; // Elements in use
+
+    int size() const { return cnt; }
+    bool empty() const { return cnt == 0; }
+    T* begin() { return items; }
+    T* end() { return items + cnt; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + cnt; }
+    const T* cbegin() const { return items; }
+    const T* cend() const { return items + cnt; }
+    T& front() { return items[0]; }
+    T& back() { return items[cnt - 1]; }
+    const T& front() const { return items[0]; }
+    const T& back() const { return items[cnt - 1]; }
+    T& operator[](int i) { return items[i]; }
+    const T& operator[](int i) const { return items[i]; }
 
-// Set: Stores all valid ranks for validation
-const std::set<std::string> VALRANKS = {
-    "A", "2", "3", "4", "5", "6", "7", "8", "9", "10", "J", "Q", "K" // Valid ranks
+    // Appends an element; the capacity is a hard limit
+    void push_back(const T& val) {
+        if (cnt == N) throw std::length_error("InlVec capacity exceeded");
+        items[cnt++] = val;
+    }
+    // Appends a default element and returns it
+    T& emplace_back() {
+        push_back(T());
+        return back();
+    }
+    void pop_back() { --cnt; }
+    void clear() { cnt = 0; }
+
+    // Inserts before pos, shifting later elements up; earlier ones stay put
+    T* insert(T* pos, const T& val) {
+        if (cnt == N) throw std::length_error("InlVec capacity exceeded");
+        std::move_backward(pos, end(), end() + 1);
+        *pos = val;
+        ++cnt;
+        return pos;
+    }
+    // Removes [first, last), shifting later elements down
+    T* erase(T* first, T* last) {
+        std::move(last, end(), first);
+        cnt -= static_cast<int>(last - first);
+        return first;
+    }
 };
 
+// Hand capacity: every card adds at least 1 to the hard total and a hand
+// stops drawing at 21, so at most 20 cards can be held before the last hit
+const int MAXHND = 21;
+// Hands one player can hold in a round: resplitting up to four hands, the
+// most any rule set may allow (spltHnds is checked against it)
+const int MAXHNDS = 4;
+
 // Hand Structures
+// Cards are added and removed only through add/popCrd/clrCrds so the
+// running totals stay in step with the card array
 struct Hand {
-    std::list<Card> cards; // Hand is a list of cards
+    InlVec<Card, MAXHND> cards; // Hand is an inline array of cards
     int bet = 0; // Bet amount for this hand
     bool isplit = false; // Flag to indicate if this hand is a result of a split
     bool ddown = false; // Flag for double down
+    bool surr = false; // Surrendered: half the bet is returned at settlement
+    uint8_t seat = 0; // Owner's player id (0 = dealer), for the event log
+    uint8_t idx = 0; // Position among the owner's hands
+    int hard = 0; // Running total with Aces counted as 1
+    int aces = 0; // Number of Aces held
+    bool soft = false; // One Ace is counting as 11
+
+    // Appends a card and updates the totals in O(1)
+    void add(Card c) {
+        cards.push_back(c);
+        hard += c.hard();
+        aces += c.isAce();
+        soft = (aces > 0) & (hard <= 11); // At most one Ace can count as 11
+    }
+    // Removes and returns the last card, updating the totals
+    Card popCrd() {
+        Card c = cards.back();
+        cards.pop_back();
+        hard -= c.hard();
+        aces -= c.isAce();
+        soft = (aces > 0) & (hard <= 11);
+        return c;
+    }
+    // Removes every card and resets the totals
+    void clrCrds() {
+        cards.clear();
+        hard = aces = 0;
+        soft = false;
+    }
+    // Best Blackjack score: the hard total, plus 10 if soft
+    int score() const { return hard + soft * 10; }
 };
 
 // Player Structure
@@ -76,705 +212,4749 @@ struct Player {
     int id; // Player ID
     std::string name; // Player Name
     int chips = 1000; // Starting chips
-    // List: Player can have multiple hands (for splits)
-    std::list<Hand> hands;
+    // Inline array: Player can have multiple hands (for splits)
+    InlVec<Hand, MAXHNDS> hands;
     // Operator for sorting by chips (descending)
         bool operator<(const Player& oth) const {
             return chips > oth.chips; // Descending order
         }
 };
 
-// Deck Management
+// Player Registry
+// Dense player store indexed by id. A player's id is its slot, fixed
+// while it is registered, so lookups are an array index and an id is a
+// stable handle (slots never move: the capacity is set up front). A
+// status byte per slot, kept in its own array, marks free slots, players
+// waiting to be dealt in and seated players; order holds the seated ids
+// in play order, which is ascending id. Player records stay whole
+// because every round function works on one player's chips and hands
+// together; the batch simulator keeps the fully split layout.
+enum PlyrSt : uint8_t { PS_FREE, PS_WAIT, PS_SEAT };
 
-// Function to simulate random access on a std::list
-// Returns a pointer to the card at the nth position (0-indexed)
-// Note: This is O(N) complexity, not O(1) like std::vector
-Card* getNthCard(std::list<Card>& deck, int n) {
-    // Check for out-of-bounds access
-    if (n < 0 || n >= deck.size()) {
-        return nullptr; // Return null if index is invalid
+struct PlyrReg {
+    std::vector<Player> slot; // Player records by id (id 0 is the dealer, never stored)
+    std::vector<uint8_t> stat; // PlyrSt of each slot
+    std::vector<int> order; // Seated ids in play order
+    int nReg = 0; // Slots in use (waiting or seated)
+
+    explicit PlyrReg(int cap) : slot(cap + 1), stat(cap + 1, PS_FREE) {
+        order.reserve(cap);
+        for (int id = 0; id <= cap; ++id) slot[id].id = id;
     }
-    
-    // Iterator to the beginning of the list
-    auto it = deck.begin();
-    
-    // std::advance moves the iterator 'n' steps forward
-    std::advance(it, n);
-    
-    // Return a pointer to the element the iterator points to
-    return &(*it);
-}
 
-// Global Containers for Game State
-std::list<Card> deck;          // Deck of cards
-std::stack<Card> disPile;      // LIFO discard
-std::queue<Player*> playQue;   // Tracks turn order
+    int cap() const { return static_cast<int>(slot.size()) - 1; } // Most players
+    int size() const { return static_cast<int>(order.size()); } // Seated players
+    bool empty() const { return order.empty(); }
+    Player& operator[](int id) { return slot[id]; } // By id, O(1)
+    Player& nth(int i) { return slot[order[i]]; } // The ith seated player in play order
 
-// Function Prototypes Here
+    // Registers a player in the lowest free slot and returns its id, either
+    // seated now or waiting for seat(); throws when every slot is taken
+    int add(const std::string& name, int chips, bool seatNow = true) {
+        int id = 1;
+        while (id <= cap() && stat[id] != PS_FREE) ++id;
+        if (id > cap()) throw std::length_error("Player registry is full");
+        Player& p = slot[id]; // Reused record: name keeps its buffer
+        p.name = name;
+        p.chips = chips;
+        p.hands.clear();
+        stat[id] = PS_WAIT;
+        ++nReg;
+        if (seatNow) seat(id);
+        return id;
+    }
 
-// Clear input buffer
-void clear_in() {
-    std::cin.clear(); // Clear any error flags
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
-}
+    // Deals a waiting player into rounds, keeping order ascending
+    void seat(int id) {
+        stat[id] = PS_SEAT;
+        order.insert(std::upper_bound(order.begin(), order.end(), id), id);
+    }
 
-// Scoring Functions
-// Calculates the best Blackjack score for a hand.
-int calcScr(const Hand& hand) {
-    if (hand.cards.empty()) { // No cards means score is 0
-        return 0;
+    // Frees a slot
+    void remove(int id) {
+        if (stat[id] == PS_SEAT) order.erase(std::find(order.begin(), order.end(), id));
+        stat[id] = PS_FREE;
+        --nReg;
     }
 
-    // Use std::accumulate to sum card values and count Aces
-    auto result = std::accumulate(hand.cards.cbegin(), hand.cards.cend(), std::make_pair(0, 0),
-        // Pair: first = sum of non-Ace values, second = count of Aces
-        [](std::pair<int, int> acc, const Card& c) {
-            if (c.rank == "A") { // Ace handling
-                acc.second += 1; // Count Aces
-            } else {
-                acc.first += c.value; // Sum non-Ace values
-            }
-            return acc;
+    // Removes every seated player for which pred returns true
+    template <class F>
+    void dropIf(F pred) {
+        for (int i = 0; i < size();) {
+            int id = order[i];
+            if (pred(slot[id])) remove(id); // The next player moves into position i
+            else ++i;
         }
-    );
+    }
 
-    // Unpack results
-    int initial = result.first; // Sum of non-Ace values
-    int ace_cnt = result.second; // Number of Aces
-    int score = initial; // Start with non-Ace sum
+    // Iteration over the seated players in play order
+    struct iter {
+        PlyrReg* reg;
+        const int* pos;
+        Player& operator*() const { return reg->slot[*pos]; }
+        Player* operator->() const { return &reg->slot[*pos]; }
+        iter& operator++() { ++pos; return *this; }
+        bool operator!=(const iter& oth) const { return pos != oth.pos; }
+    };
+    iter begin() { return iter{this, order.data()}; }
+    iter end() { return iter{this, order.data() + order.size()}; }
+};
 
-    // Add Aces as 11 initially
-    score += ace_cnt * 11;
+// Deck Management
 
-    // Adjust Ace values
-    while (score > 21 && ace_cnt > 0) { // While busting and have Aces to adjust
-        score -= 10; // Change 11 to 1 (11 - 1 = 10 difference)
-        ace_cnt--; // One less Ace to adjust
-    }
+// Random Number Generator
+// xoshiro256** seeded through splitmix64: 32 bytes of state, a few
+// cycles per draw, and cheap enough to keep for the whole run.
+// A run derives every table's stream from one master seed: table t gets
+// the master stream advanced by t jumps of 2^128 draws, so streams never
+// overlap and each depends only on (seed, t).
+struct Rng {
+    uint64_t s[4]; // Generator state
 
-    // Final score
-    return score; // Final score
-}
+    explicit Rng(uint64_t sd = 0) { seed(sd); }
 
-// Checks if a hand is a natural Blackjack (21 with 2 cards).
-bool is_nat(const Hand& hand) {
-    // Natural only if 2 cards and not a split hand
-    return calcScr(hand) == 21 && hand.cards.size() == 2 && !hand.isplit;
-}
+    // Expands a 64-bit seed into the full state with splitmix64
+    void seed(uint64_t sd) {
+        for (uint64_t& w : s) {
+            uint64_t z = (sd += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            w = z ^ (z >> 31);
+        }
+    }
 
-// Deck Management
-// Creates a standard deck with the specified number of decks.
-void createDk(int num_dk) { // Number of decks to create
-    deck.clear(); // Clear existing deck
-    while(!disPile.empty()) disPile.pop(); // Clear discard pile
+    // Next 64 random bits
+    uint64_t next() {
+        uint64_t res = rotl(s[1] * 5, 7) * 9;
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return res;
+    }
 
-    // Nested loops to create the deck(s)
-    for (int d = 0; d < num_dk; ++d) {
-        // Nested iteration over map and list
-        for (const auto& r_pair : CRDVALS) {  // r_pair: (rank, value)
-            for (const std::string& suit : SUITS) {
-                Card c = {r_pair.first, suit, r_pair.second}; // Create card
-                deck.push_back(c); // Add to deck
+    // Uniform integer in [0, n) without modulo bias (Lemire's method)
+    uint32_t below(uint32_t n) {
+        uint64_t m = (next() >> 32) * n; // Scale 32 random bits onto [0, n)
+        uint32_t low = static_cast<uint32_t>(m);
+        if (low < n) { // Possibly in the biased zone
+            uint32_t thr = -n % n; // 2^32 mod n
+            while (low < thr) { // Reject and redraw
+                m = (next() >> 32) * n;
+                low = static_cast<uint32_t>(m);
             }
         }
+        return static_cast<uint32_t>(m >> 32);
+    }
+
+    // Advances the state by 2^128 draws (the xoshiro256 jump polynomial)
+    void jump() {
+        const uint64_t JMP[4] = {0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL,
+                                 0x39ABDC4529B1661CULL};
+        jumpBy(JMP);
+    }
+    // Advances the state by 2^192 draws, for 2^64 streams of 2^128 jumps each
+    void longJump() {
+        const uint64_t JMP[4] = {0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL, 0x77710069854EE241ULL,
+                                 0x39109BB02ACBE635ULL};
+        jumpBy(JMP);
+    }
+    void jumpBy(const uint64_t (&poly)[4]) {
+        uint64_t t[4] = {};
+        for (uint64_t w : poly) {
+            for (int b = 0; b < 64; ++b) {
+                if (w & (1ULL << b)) for (int i = 0; i < 4; ++i) t[i] ^= s[i];
+                next();
+            }
+        }
+        std::memcpy(s, t, sizeof(s));
     }
-}
 
-// Shuffles the deck using a custom algorithm with list iterators
-void shufDk() {
-    if (deck.empty()) return; // Don't shuffle an empty deck
+    static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
 
-    // Temporary list for shuffling
-    std::list<Card> tmpDk;
-    tmpDk.splice(tmpDk.begin(), deck); // Efficiently moves all elements
+// Stream of table idx for a run seeded with sd
+Rng tblRng(uint64_t sd, int idx) {
+    Rng g(sd); // Master stream
+    for (int i = 0; i < idx; ++i) g.jump();
+    return g;
+}
 
-    // Random number generator setup
-    unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
-    std::mt19937 g(seed);
+// Shoe capacity
+const int DKSIZE = NRANKS * NSUITS; // Cards per standard deck
+const int MAXDK = 8; // Most decks a shoe can hold
 
-    int n = tmpDk.size(); // Number of cards
-    if (n == 0) return;
-    
-    // Custom list-based shuffle
-    for (int i = 0; i < n * 2; ++i) { // Shuffle iterations n*2
-        auto it_from = tmpDk.begin(); // Iterator to select card
-        // Iterator: std::advance to a random position
-        std::advance(it_from, g() % n);
+// Shoe Structure
+// Fixed-capacity contiguous card buffer with a deal cursor.
+// Cards [pos, len) are still to be dealt, so dealing is an index
+// increment and penetration is simply pos.
+// The discard pile is the region [0, nDisc): dealt slots are free once
+// their card is in a hand, so discards overwrite them from the front.
+// [nDisc, pos) is then exactly the number of cards still in play.
+struct Shoe {
+    Card cards[MAXDK * DKSIZE]; // Card buffer (one byte per card)
+    int len = 0; // Cards loaded into the buffer
+    int pos = 0; // Deal cursor: index of the next card
+    int nDisc = 0; // Cards in the discard region
 
-        // Remove card from current position
-        Card c = *it_from; // Copy card
-        it_from = tmpDk.erase(it_from); // Erase returns iterator to next element
-        
-        // Insert card at new random position
-        int trgPos = g() % n; // Target position
-        auto it_to = tmpDk.begin(); // Iterator to insert position
-        std::advance(it_to, trgPos); // Move to target position
+    int size() const { return len - pos; } // Cards left to deal
+    bool empty() const { return pos >= len; } // No cards left to deal
+    int dealt() const { return pos; } // Penetration in cards
+    int inPlay() const { return pos - nDisc; } // Dealt and not yet discarded
+    void clear() { len = pos = nDisc = 0; } // Empty the buffer and reset the cursor
+    void push(Card c) { cards[len++] = c; } // Append a card at the back
+    Card deal() { return cards[pos++]; } // Take the next card
+    Card* begin() { return cards + pos; } // First card left to deal
+    Card* end() { return cards + len; } // One past the last card
 
-        // Insert card
-        tmpDk.insert(it_to, c);
+    // Returns a card from a hand to the discard region
+    void disc(Card c) {
+        if (nDisc >= pos) throw std::logic_error("Discarded a card that was never dealt");
+        cards[nDisc++] = c;
     }
-    // Move shuffled cards back to deck
-    deck.splice(deck.begin(), tmpDk);
-}
 
-// Deals a card from the deck to the hand, reshuffling if necessary
-// Uses list iterators for deck management
-void dealCrd(std::list<Card>& trgLst) { // Target list to receive card
-    // Reshuffle if deck is empty
-    if (deck.empty()) {
-        std::cout << "\n--- Reshuffling Discard Pile ---\n";
-        
-        // Move cards from stack to list for reshuffling
-        while (!disPile.empty()) { // While discard pile not empty
-            deck.push_back(disPile.top()); // List push_back
-            disPile.pop(); // Stack pop
-        }
-        shufDk(); // Shuffle the deck
-        if (deck.empty()) { // Still empty after reshuffle
-             throw std::runtime_error("No cards left to deal or shuffle!");
+    // Puts the discards back with the undealt cards as one contiguous
+    // block [pos, len) ready to shuffle. Cards still in play keep a gap
+    // of their size at the front for when they are discarded. At a round
+    // boundary nothing is in play and this is just a cursor reset.
+    void rcyl() {
+        int gap = inPlay(); // Slots reserved for cards still in hands
+        if (gap > 0) std::memmove(cards + gap, cards, nDisc); // One bulk move, no per-card copies
+        pos = gap; // Everything after the gap is dealable again
+        nDisc = 0;
+    }
+
+    // Continuous shuffling: returns a card to a uniformly random position
+    // among the cards left to deal, in O(1). The card goes in at the back
+    // and swaps with a random slot in [pos, len], the inside-out
+    // Fisher-Yates step, so a uniform shoe stays uniform. When the back is
+    // at capacity the undealt cards slide to the front first; that happens
+    // at most once per shoe's worth of dealt cards.
+    void rein(Card c, Rng& g) {
+        if (len == MAXDK * DKSIZE) {
+            std::memmove(cards, cards + pos, len - pos);
+            len -= pos;
+            pos = 0;
         }
+        cards[len] = c;
+        std::swap(cards[len], cards[pos + g.below(len - pos + 1)]);
+        ++len;
     }
-    
-    // Iterator: deck.begin() gives an iterator to the first element
-    trgLst.push_back(*deck.begin());
-    deck.pop_front();
-}
+};
 
-// Moves all cards from a Hand to the discard pile.
-void discHnd(Hand& hand) {
-    // STL Algorithm: std::for_each to iterate and push to stack
-    std::for_each(hand.cards.begin(), hand.cards.end(), [](const Card& c) {
-        disPile.push(c); // Stack push
-    });
-    hand.cards.clear(); // List clear
-    hand.bet = 0; // Reset bet
+// Returns a pointer to the card at the nth position (0-indexed) of the
+// cards left to deal; O(1) since the shoe is contiguous
+Card* getNthCard(Shoe& deck, int n) {
+    // Check for out-of-bounds access
+    if (n < 0 || n >= deck.size()) {
+        return nullptr; // Return null if index is invalid
+    }
+
+    // Return a pointer to the card n past the deal cursor
+    return deck.begin() + n;
 }
 
-// Display Functions
-// Print hand, optionally hiding second card
+// Shuffle algorithms selectable per run. CSM models a continuous
+// shuffling machine: the shoe is shuffled once (Fisher-Yates) and every
+// discard goes straight back in at a random position, with no cut card.
+enum class ShufAlg { FY, LEGACY, CSM };
 
-void prntHnd(const Hand& hand, bool hide_1 = false) {
-    std::cout << "[ "; // Start hand display
-    int count = 0; // Card counter
-    
-    // Iterator: std::list::const_iterator
-    for (auto it = hand.cards.cbegin(); it != hand.cards.cend(); ++it) {
-        // Hide second card if specified
-        if (hide_1 && count == 1) {
-            // Hidden card representation
-            std::cout << "XX ";
+// Event Log
+// Every deal, decision, settlement and reshuffle can be recorded as a
+// fixed-size 16-byte binary record. Tables fill large blocks locally and
+// hand full blocks to a background writer thread, so logging costs a
+// store per event on the hot path and never waits on file I/O.
+
+// Event types
+enum EvtType : uint8_t {
+    EV_DEAL = 'C', // Card dealt: val = card code, score = hand score after
+    EV_ACT = 'A',  // Decision: val = action letter, score = hand score before
+    EV_SETL = 'S', // Settlement: val = outcome letter, amt = net chips
+    EV_SHUF = 'R'  // Reshuffle: val = 0 at a round start, 1 mid-round; amt = cards shuffled
+};
+
+// Event Record (fixed size, written to disk as-is)
+struct EvtRec {
+    uint32_t rnd;   // Round number on this table
+    uint16_t tbl;   // Table index
+    uint8_t type;   // EvtType
+    uint8_t seat;   // Player id (0 = dealer)
+    uint8_t hand;   // Hand index within the seat
+    uint8_t val;    // Card code, action or outcome
+    uint8_t score;  // Hand score
+    uint8_t flags;  // Reserved
+    int32_t amt;    // Chips (settlement) or card count (reshuffle)
+};
+static_assert(sizeof(EvtRec) == 16, "EvtRec must stay 16 bytes");
+
+// Event log file header, one record in size
+const char EVMAGIC[4] = {'B', 'J', 'E', 'V'};
+const uint32_t EVVERS = 1; // Record layout version
+
+// Records per block handed to the writer (1 MiB blocks)
+const size_t EVBLK = 65536;
+// Full blocks allowed to queue before tables wait for the writer
+const size_t EVMAXQ = 64;
+
+// Event Log Writer
+// Owns the output file and a writer thread; any number of tables may
+// submit blocks concurrently. Blocks are recycled, so a steady-state run
+// allocates nothing per block.
+struct EvtLog {
+    std::ofstream out; // Binary output file
+    std::mutex mtx; // Guards the queues below
+    std::condition_variable cv; // Signals new work or free space
+    std::deque<std::vector<EvtRec>> full; // Blocks waiting to be written
+    std::vector<std::vector<EvtRec>> spare; // Written blocks for reuse
+    bool done = false; // Set when the log is closing
+    std::thread wrtr; // Background writer
+
+    explicit EvtLog(const std::string& path) : out(path, std::ios::binary | std::ios::trunc) {
+        if (!out) throw std::runtime_error("Cannot open event log " + path);
+        EvtRec hdr = {}; // Header: magic in the first bytes, version in amt
+        std::memcpy(&hdr, EVMAGIC, sizeof(EVMAGIC));
+        hdr.amt = static_cast<int32_t>(EVVERS);
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        wrtr = std::thread([this]() { drain(); });
+    }
+
+    // Flushes everything still queued and closes the file
+    ~EvtLog() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            done = true;
+        }
+        cv.notify_all();
+        wrtr.join();
+    }
+
+    // Queues a full block for writing and gives the caller an empty one
+    void submit(std::vector<EvtRec>& blk) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this]() { return full.size() < EVMAXQ; }); // Back-pressure
+        full.push_back(std::move(blk));
+        if (!spare.empty()) { // Reuse a written block
+            blk = std::move(spare.back());
+            spare.pop_back();
         } else {
-            std::cout << *it << " "; // Use overloaded operator
+            blk = std::vector<EvtRec>();
         }
-        count++; // Increment card counter
+        lk.unlock();
+        cv.notify_all();
+        blk.clear();
+        blk.reserve(EVBLK);
     }
-    std::cout << "]";
-}
 
-// Print player statistics and hands
-void prntStat(const Player& p, bool inclHnd = true) {
-    // Player header display with chips
-    std::cout << "\n**Player " << p.id << " (" << p.name << ")** - Chips: $" << p.chips << "\n";
-    // Include the hand details
-    if (inclHnd) {
-        int hndCnt = 1; // Hand counter
-        // Iterator: Iterate over all hands
-        for (const auto& hand : p.hands) {
-            int score = calcScr(hand); // Calculate hand score
-            std::cout << "  Hand " << hndCnt++; // Hand number
-            if (hand.isplit) std::cout << " (Split)"; // Indicate split hand
-            if (hand.ddown) std::cout << " (DD)"; // Indicate double down hand
-            std::cout << " Bet: $" << hand.bet << " Score: (" << score << "): ";
-            prntHnd(hand, false); // Print hand cards
-            std::cout << "\n";
+    // Writer thread: writes blocks in arrival order until closed
+    void drain() {
+        std::unique_lock<std::mutex> lk(mtx);
+        for (;;) {
+            cv.wait(lk, [this]() { return done || !full.empty(); });
+            if (full.empty()) break; // Closed and drained
+            std::vector<EvtRec> blk = std::move(full.front());
+            full.pop_front();
+            lk.unlock();
+            cv.notify_all(); // Room in the queue again
+            out.write(reinterpret_cast<const char*>(blk.data()), blk.size() * sizeof(EvtRec));
+            lk.lock();
+            spare.push_back(std::move(blk));
         }
+        out.flush();
     }
-}
+};
 
-// Game Logic Functions
+// Per-Table Event Buffer
+// Collects one table's records into the current block
+struct EvtBuf {
+    EvtLog* log; // Shared writer
+    uint16_t tbl; // Table index stamped on every record
+    uint32_t rnd = 0; // Current round number
+    std::vector<EvtRec> blk; // Block being filled
 
-// Handles the "Hit" action for a specific hand.
-// Reference to hand to modify
-void playHit(Hand& hand) {
-    std::cout << "Player hits. Dealing card.\n";
-    dealCrd(hand.cards); // Deal card to hand
-}
+    EvtBuf(EvtLog* lg, int t) : log(lg), tbl(static_cast<uint16_t>(t)) { blk.reserve(EVBLK); }
+    ~EvtBuf() { flush(); }
 
-// Handles the "Split" action for a player.
-// Modifies the player's hands list and the current hand iterator.
-void playSplt(Player& p, std::list<Hand>::iterator& curIt) {
-    Hand& origHnd = *curIt; // Reference to the original hand
-    
-    // Check if splitting is valid (two cards of the same rank)
-    if (origHnd.cards.size() != 2 || origHnd.cards.front().rank != origHnd.cards.back().rank) { // Invalid split
-        std::cout << "Cannot split this hand.\n";
-        return;
+    // Appends one record; hands the block off when it is full
+    void put(uint8_t type, int seat, int hand, int val, int score, int amt) {
+        blk.push_back(EvtRec{rnd, tbl, type, static_cast<uint8_t>(seat), static_cast<uint8_t>(hand),
+                             static_cast<uint8_t>(val), static_cast<uint8_t>(score), 0, amt});
+        if (blk.size() == EVBLK) log->submit(blk);
     }
 
-    // Check if player has enough chips to place the second bet
-    if (p.chips < origHnd.bet) {
-        std::cout << "Not enough chips to place a second bet for splitting.\n";
-        return;
+    // Hands off a partly filled block (end of run)
+    void flush() {
+        if (!blk.empty()) log->submit(blk);
     }
+};
 
-    // Proceed with split
-    std::cout << "Splitting Hand. Placing additional $" << origHnd.bet << " bet.\n";
-
-    // Create the new hand (the second split hand)
-    Hand newHnd; // New hand for the split
-    newHnd.bet = origHnd.bet; // Same bet as original hand
-    newHnd.isplit = true; // Mark as split hand
-    
-    // Move the second card from the original hand to the new hand
-    // Iterator: Get iterator to the second card (list::begin() and advance)
-    auto scndIt = origHnd.cards.begin();
-    std::advance(scndIt, 1); // Move to second card
-    
-    // Move card to new hand
-    newHnd.cards.push_back(*scndIt);
-    origHnd.cards.erase(scndIt); // Remove from original hand
+// Replay File
+// --record FILE keeps every round in a compact append-only file so any
+// round can be re-dealt and re-settled later. The file is a header with
+// the seed and rules, then one record per round: a fixed part (table,
+// round, shoe cursor, counts), each seat's chips, bet and net, the cards
+// in the order they were dealt, and every decision. FILE.idx holds one
+// 64-bit offset per record, so round N is found with one lookup in a
+// memory-mapped index however long the file grows.
 
-    // Insert the new hand *after* the original hand in the player's hands list
-    // This allows the player to play the hands sequentially (original first, then new)
-    curIt++; // Move iterator to the position AFTER the original hand
-    p.hands.insert(curIt, newHnd); // Insert new hand
-    curIt--; // Move iterator back to point to the original hand for continued play
-    
-    // Update chip count and deal second cards
-    p.chips -= newHnd.bet;
-    
-    // Deal the second card to the original hand
-    dealCrd(origHnd.cards);
-    
-    // Deal the second card to the new hand (now located one position forward)
-    curIt++; // Iterator to the new hand
-    dealCrd(curIt->cards);
-    curIt--; // Iterator back to the original hand
+const char RPMAGIC[4] = {'B', 'J', 'R', 'P'};
+const uint32_t RPVERS = 1; // Record layout version
+const size_t RPBLK = 1 << 20; // Bytes of records a table collects before appending them
+const char RPACTS[] = "HSDRP?"; // Decision bytes a record may hold; '?' is any invalid choice
+const int32_t RPMAXCHP = std::numeric_limits<int32_t>::max() / 4; // Most chips a recorded seat may hold
 
-    std::cout << "Split successful. Playing the first hand...\n";
+// Largest bet a replay may hold when naturals pay bjNum:bjDen. With at
+// most RPMAXCHP chips and bets under this, settling every hand of a seat,
+// doubled and paid, stays inside int.
+inline int32_t rpMaxBet(int bjNum) {
+    return static_cast<int32_t>(std::numeric_limits<int32_t>::max() /
+                                (4LL * MAXHNDS * std::max<long long>(bjNum, 2)));
 }
 
-// Handles the "Double Down" action for a player.
-void playDD(Player& p, Hand& hand) { // Reference to player and hand
-    // Check if Double Down is valid (only on initial two cards)
-    if (hand.cards.size() != 2) { // If not initial two cards
-        std::cout << "Double Down only allowed on initial two cards.\n";
-        return;
-    }
-    if (p.chips < hand.bet) { // If not enough chips
-        std::cout << "Not enough chips to Double Down.\n";
-        return;
-    }
+// Replay file header
+struct RpHdr {
+    char magic[4];
+    uint32_t vers;
+    uint64_t seed; // Run seed, for reference
+    int32_t preset; // Compiled rule set, -1 for the rules below
+    int32_t shufAlg; // Shuffle of the recorded run, for reference
+    int32_t rul[9]; // RuleSet fields, in declaration order
+    int32_t rsv; // Zero
+};
+static_assert(sizeof(RpHdr) == 64, "RpHdr must stay free of padding");
 
-    // Proceed with Double Down and output
-    std::cout << "Player Doubles Down! Betting an additional $" << hand.bet << ".\n";
-    p.chips -= hand.bet; // Deduct additional bet
-    hand.bet *= 2; // Double the bet
-    hand.ddown = true; // Mark hand as double down
-    
-    // Player gets exactly one card
-    playHit(hand);
-    
-    // Show final hand and output score
-    std::cout << "Final Hand Score: (" << calcScr(hand) << ")\n";
-    prntHnd(hand);
-    std::cout << "\n";
-}
+// Fixed part of a round record
+struct RpRnd {
+    uint32_t rnd; // Round number on its table
+    uint16_t tbl; // Table index
+    uint16_t pos; // Shoe cursor when the round started
+    uint16_t nCrd; // Cards dealt
+    uint16_t nAct; // Decisions taken
+    uint8_t nSeat; // Seats that played
+    uint8_t rsv[3]; // Zero
+};
+static_assert(sizeof(RpRnd) == 16, "RpRnd must stay 16 bytes");
 
-// Processes the outcome of a single hand against the dealer.
-// Updates player chips based on the result.
-// References to player, player's hand, and dealer's hand
-void setHnd(Player& p, Hand& hand, const Hand& dlHnd) {
-    int p_score = calcScr(hand); // Player's hand score
-    int d_score = calcScr(dlHnd); // Dealer's hand score
+// One seat's part of a round record
+struct RpSeat {
+    int32_t id; // Player id
+    int32_t chips; // Chips before the bet
+    int32_t bet; // Initial bet
+    int32_t net; // Net chips won over the round
+};
 
-    // Output settlement header
-    std::cout << "\n--- Settlement for " << p.name << "'s hand (Score: " << p_score << ") ---\n";
+// Replay Writer
+// Appends whole blocks of records from any number of tables, with the
+// index entries for them
+struct RpLog {
+    std::ofstream dat; // Records
+    std::ofstream idx; // One offset per record
+    uint64_t end = 0; // Size of the record file so far
+    std::mutex mtx; // Serializes appends
 
-    // Player bust
-    if (p_score > 21) {  // If score is over 21
-        std::cout << "Player BUSTS. Bet of $" << hand.bet << " lost.\n";
-        // Chips already deducted at bet time
+    RpLog(const std::string& path, const RpHdr& hdr)
+        : dat(path, std::ios::binary | std::ios::trunc), idx(path + ".idx", std::ios::binary | std::ios::trunc) {
+        if (!dat || !idx) throw std::runtime_error("Cannot open replay file " + path);
+        dat.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        end = sizeof(hdr);
     }
-    // Both have naturals
-    else if (is_nat(hand) && is_nat(dlHnd)) {
-        std::cout << "PUSH (Natural vs. Natural). Bet of $" << hand.bet << " returned.\n";
-        p.chips += hand.bet; // Return original bet
+
+    // Appends a block; offs are the offsets of its records within it
+    void append(const std::vector<uint8_t>& blk, std::vector<uint64_t>& offs) {
+        std::lock_guard<std::mutex> lk(mtx);
+        for (uint64_t& o : offs) o += end;
+        dat.write(reinterpret_cast<const char*>(blk.data()), blk.size());
+        idx.write(reinterpret_cast<const char*>(offs.data()), offs.size() * sizeof(uint64_t));
+        end += blk.size();
     }
-    // Natural blackjack for player
-    else if (is_nat(hand)) {
-        int winAmt = static_cast<int>(hand.bet * 1.5); // 1.5x winnings
-        std::cout << "NATURAL BLACKJACK! Wins 1.5x. $" << winAmt << " won (Total return: $" << hand.bet + winAmt << ").\n";
-        p.chips += hand.bet + winAmt; // Return original bet + winnings
+};
+
+// Per-Table Replay Buffer
+// Assembles the current round and collects finished records into a block
+struct RpBuf {
+    RpLog* log; // Shared writer
+    uint16_t tbl; // Table index stamped on every record
+    uint32_t rnd = 0; // Rounds recorded on this table
+    RpRnd cur = {}; // Round being recorded
+    std::vector<RpSeat> seats; // Its seats
+    size_t nNet = 0; // Seats settled so far
+    std::vector<uint8_t> crds; // Its cards, as codes
+    std::vector<uint8_t> acts; // Its decisions
+    std::vector<uint8_t> blk; // Finished records
+    std::vector<uint64_t> offs; // Their offsets in blk
+    int32_t maxBet; // rpMaxBet for the run's rules
+
+    RpBuf(RpLog* lg, int t, int32_t mxBet) : log(lg), tbl(static_cast<uint16_t>(t)), maxBet(mxBet) {
+        seats.reserve(8);
+        crds.reserve(512);
+        acts.reserve(256);
+        blk.reserve(RPBLK + 4096);
+        offs.reserve(RPBLK / sizeof(RpRnd));
     }
-    // Dealer bust
-    else if (d_score > 21) { // If score is over 21 for dealer
-        std::cout << "Dealer BUSTS (" << d_score << "). Player wins $" << hand.bet << ".\n";
-        p.chips += hand.bet * 2; // Return original bet + winnings
+    ~RpBuf() { flush(); }
+
+    void begin(int pos) {
+        cur = RpRnd();
+        cur.rnd = ++rnd;
+        cur.tbl = tbl;
+        cur.pos = static_cast<uint16_t>(pos);
+        seats.clear();
+        nNet = 0;
+        crds.clear();
+        acts.clear();
     }
-    // Dealer has natural blackjack
-    else if (is_nat(dlHnd)) {
-        std::cout << "Dealer has NATURAL BLACKJACK. Bet of $" << hand.bet << " lost.\n";
+    void bet(const Player& p, int amt) {
+        if (p.chips > RPMAXCHP || amt > maxBet) throw std::runtime_error("Stake too large to record in a replay");
+        seats.push_back(RpSeat{p.id, p.chips, amt, 0});
     }
-    // Compare scores
-    else if (p_score > d_score) { // Player wins
-        std::cout << "Player Wins (" << p_score << " > " << d_score << "). Wins $" << hand.bet << ".\n";
-        p.chips += hand.bet * 2; // Return original bet + winnings
+    void crd(Card c) { crds.push_back(c.code); }
+    void act(char a) { acts.push_back(static_cast<uint8_t>(std::strchr(RPACTS, a) ? a : '?')); } // Any invalid choice as '?'
+    void net(long long amt) { seats[nNet++].net = static_cast<int32_t>(amt); } // Seats settle in bet order
+
+    // Closes the round's record
+    void end() {
+        cur.nCrd = static_cast<uint16_t>(crds.size());
+        cur.nAct = static_cast<uint16_t>(acts.size());
+        cur.nSeat = static_cast<uint8_t>(seats.size());
+        offs.push_back(blk.size());
+        const uint8_t* r = reinterpret_cast<const uint8_t*>(&cur);
+        blk.insert(blk.end(), r, r + sizeof(cur));
+        const uint8_t* s = reinterpret_cast<const uint8_t*>(seats.data());
+        blk.insert(blk.end(), s, s + seats.size() * sizeof(RpSeat));
+        blk.insert(blk.end(), crds.begin(), crds.end());
+        blk.insert(blk.end(), acts.begin(), acts.end());
+        if (blk.size() >= RPBLK) flush();
     }
-    else if (p_score < d_score) { // Dealer wins
-        std::cout << "Dealer Wins (" << d_score << " > " << p_score << "). Bet of $" << hand.bet << " lost.\n";
+
+    void flush() {
+        if (offs.empty()) return;
+        log->append(blk, offs);
+        blk.clear();
+        offs.clear();
     }
-    else { // Push
-        std::cout << "PUSH (" << p_score << " vs. " << d_score << "). Bet of $" << hand.bet << " returned.\n";
-        p.chips += hand.bet; // Return original bet
+};
+
+// Card Counting
+// A tag system gives each rank a count value. The running count is
+// updated by one table lookup as each card is exposed, so it never has to
+// be recomputed from the shoe.
+
+// Tag System
+struct TagSys {
+    const char* name; // Name for the command line
+    int8_t tag[NRANKS]; // Count value per rank (A, 2-10, J, Q, K)
+    int irc; // Initial running count per deck (unbalanced systems)
+    bool bal; // Balanced: a full shoe counts to zero
+};
+
+// Supported tag systems, indexed by CntSys
+enum class CntSys { HILO, KO, OMEGA2 };
+const TagSys TAGSYS[] = {
+    {"hilo", {-1, 1, 1, 1, 1, 1, 0, 0, 0, -1, -1, -1, -1}, 0, true},
+    {"ko", {-1, 1, 1, 1, 1, 1, 1, 0, 0, -1, -1, -1, -1}, -4, false},
+    {"omega2", {0, 1, 1, 2, 2, 2, 1, 0, -1, -2, -2, -2, -2}, 0, true}
+};
+
+// Count State
+// Running count of the cards exposed since the last shuffle. The dealer's
+// hole card is held back until it is turned over.
+struct Count {
+    const TagSys* sys = &TAGSYS[0]; // Active tag system
+    int run = 0; // Running count
+    bool holeDn = false; // A face-down hole card is waiting to be counted
+
+    // Starts a new shoe of nDk decks
+    void reset(int nDk) {
+        run = sys->bal ? 0 : sys->irc * nDk + 4; // KO-style pivot: IRC = 4 - 4 * decks
+        holeDn = false;
     }
-    
-    discHnd(hand);
+    void see(Card c) { run += sys->tag[c.rank()]; } // Card exposed, O(1)
+    void unsee(Card c) { run -= sys->tag[c.rank()]; } // Seen card went back into a CSM
+};
+
+// Allocation Counter
+// Replaces the global allocator so benchmarks can report heap allocations
+// per operation. The count is per thread, so it costs one increment and
+// tables on other threads never share its cache line.
+long long& allocCnt() {
+    static thread_local long long n = 0; // Allocations made by this thread
+    return n;
 }
 
+// Kept out of line: once inlined, GCC pairs the malloc with delete
+// expressions and warns of a mismatch
+__attribute__((noinline)) void* operator new(std::size_t sz) {
+    ++allocCnt();
+    if (void* p = std::malloc(sz ? sz : 1)) return p;
+    throw std::bad_alloc();
+}
 
-// Game Logic Functions
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
 
-// Handles the main player decision phase (Hit, Stand, Split, Double Down).
-void hdlPlay(Player& p, Hand& dlHnd) {
-    std::string choice; // Player choice input
-    
-    // Use a while loop with an iterator to manage the list of hands,
-    // allowing for insertion (splitting) and safe iteration.
-    auto it = p.hands.begin(); // Iterator to current hand
-    while (it != p.hands.end()) { // While there are hands to play
-        Hand& curHnd = *it; // Reference to current hand
-        bool done = false; // Flag to indicate if done playing this hand
+__attribute__((noinline)) void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
 
-        // Output current hand header
-        std::cout << "\n--- " << p.name << "'s Turn (Hand Bet: $" << curHnd.bet << ") ---\n";
-        
-        // Skip hands that were just completed by a Double Down
-        if (curHnd.ddown) {
-            ++it; // Move to the next hand
-            continue;
-        }
+// Instrumentation
+// Hot-path counters and per-phase round timings, kept per table so threads
+// never share them. Build with -DBJPROF=0 to compile every probe out;
+// otherwise the counters are always kept and phase timing runs when
+// Prof::on is set (--prof), at two timestamp reads per phase.
+#ifndef BJPROF
+#define BJPROF 1
+#endif
+constexpr bool PROF = BJPROF;
 
-        // Handle a split pair of Aces
-        if (curHnd.isplit && curHnd.cards.size() == 2 && curHnd.cards.front().rank == "A" && curHnd.cards.back().rank == "A") {
-            std::cout << "Split Aces: Only one card is dealt to each. Must stand.\n";
-            ++it; // Move to the next hand after standing
-            continue;
+// Phases of playRnd, timed back to back
+enum RndPhase { PH_BET, PH_DEAL, PH_ACT, PH_DLR, PH_SETL, NPHASE };
+const char* const PHASENM[NPHASE] = {"bets", "deal", "actions", "dealer", "settle"};
+
+// Timestamp in ticks: TSC cycles on x86, steady_clock nanoseconds elsewhere
+inline uint64_t profTick() {
+#if BJSIMD
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Instrumentation Snapshot
+// Plain counters, so snapshots from several tables can be summed
+struct ProfSnap {
+    long long rounds = 0; // Rounds played through playRnd
+    long long allocs = 0; // Heap allocations made inside playRnd
+    long long shufs = 0; // Reshuffles (cut card and mid-round)
+    long long splits = 0; // Hands split
+    long long dbls = 0; // Hands doubled
+    long long busts = 0; // Player hands busted
+    double cyc[NPHASE] = {}; // Ticks spent in each phase
+    double ns[NPHASE] = {}; // The same time in nanoseconds
+
+    ProfSnap& operator+=(const ProfSnap& oth) {
+        rounds += oth.rounds;
+        allocs += oth.allocs;
+        shufs += oth.shufs;
+        splits += oth.splits;
+        dbls += oth.dbls;
+        busts += oth.busts;
+        for (int i = 0; i < NPHASE; ++i) {
+            cyc[i] += oth.cyc[i];
+            ns[i] += oth.ns[i];
         }
+        return *this;
+    }
+};
 
-        // Inner loop for playing the current hand
-        bool split = false;
+// Per-Table Instrumentation
+struct Prof {
+    bool on = false; // Time the round phases
+    ProfSnap cur; // Counters so far (ns is filled in by snap)
+    uint64_t mark = 0; // Start of the phase being timed
+    uint64_t tick0 = 0; // Calibration start, in ticks
+    std::chrono::steady_clock::time_point clk0; // Calibration start, in wall time
 
-        // Loop until the player stands, busts, or completes the hand
-        while (!done) {
-            int score = calcScr(curHnd); // Calculate current hand score
-            std::cout << "Current Hand Score (" << score << "): ";
-            prntHnd(curHnd); // Print current hand
-            std::cout << "\n";
+    // Clears the counters and starts timing
+    void start() {
+        cur = ProfSnap();
+        on = true;
+        tick0 = profTick();
+        clk0 = std::chrono::steady_clock::now();
+    }
 
-            // Check for bust or 21
-            if (score > 21) { // If score exceeds 21
-                std::cout << "Hand Busted!\n";
-                break;
-            }
-            if (score == 21) { // If score is exactly 21
-                std::cout << "Hand is 21! Standing.\n";
-                break;
-            }
-            
-            // Prompt for action
-            std::cout << "Actions: (H)it / (S)tand";
-            
-            // Check if Split and Double Down are available
-            // Can split if two cards of same rank and not already a split hand
-            bool canSplt = (curHnd.cards.size() == 2 && curHnd.cards.front().rank == curHnd.cards.back().rank && !curHnd.isplit);
-            bool canDbl = (curHnd.cards.size() == 2 && p.chips >= curHnd.bet); // Can double down if two cards and enough chips
-            
-            // Display available actions
-            if (canSplt) std::cout << " / (P)lit"; // 'P' for sPlit to avoid confusion with 'S'tand
-            if (canDbl) std::cout << " / (D)ouble Down"; // 'D' for Double Down
-            std::cout << "\nChoose action: ";
-            
-            std::cout << " > ";
-
-            // Player chooses action
-            std::cin >> choice;
-
-            // Standardize input to uppercase
-            std::transform(choice.begin(), choice.end(), choice.begin(), ::toupper);
-            clear_in();
-            
-            // Handle player choice
-            if (choice == "H") { // Hit
-                playHit(curHnd); // Deal card to hand
-            } else if (choice == "S") { // Stand
-                done = true; // End turn for this hand
-            } else if (choice == "D" && canDbl) { // Double Down
-                playDD(p, curHnd); // Handle Double Down
-                done = true; // Double Down ends the turn for this hand
-            } else if (choice == "P" && canSplt) {
-                // The player_split function modifies the list and the iterator 'it'
-                playSplt(p, it);
-                split = true; // Mark that a split occurred
-                break;
-            } else {
-                std::cout << "Invalid or unavailable action.\n"; // Prompt again
+    // Charges the ticks since the last mark to phase ph
+    void phase(int ph) {
+        uint64_t t = profTick();
+        cur.cyc[ph] += static_cast<double>(t - mark);
+        mark = t;
+    }
+
+    // Copy of the counters with tick totals converted to nanoseconds,
+    // scaled by the tick rate measured since start
+    ProfSnap snap() const {
+        ProfSnap res = cur;
+        double ticks = static_cast<double>(profTick() - tick0);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - clk0).count();
+        double nsTick = ticks > 0 ? ns / ticks : 1.0;
+        for (int i = 0; i < NPHASE; ++i) res.ns[i] = res.cyc[i] * nsTick;
+        return res;
+    }
+};
+
+// Prints a snapshot: counters per round and the time split by phase
+void prntProf(const ProfSnap& ps) {
+    double rnds = static_cast<double>(ps.rounds ? ps.rounds : 1); // Avoid divide by zero
+    std::cout << "### Round Profile ###\n";
+    std::cout << "Rounds: " << ps.rounds << "  Reshuffles: " << ps.shufs << "  Splits: " << ps.splits
+              << "  Doubles: " << ps.dbls << "  Busts: " << ps.busts << "\n";
+    std::cout << std::setprecision(2) << "Allocations: " << ps.allocs << " (" << ps.allocs / rnds << " per round)\n";
+    double totNs = 0.0;
+    for (double v : ps.ns) totNs += v;
+    if (totNs <= 0.0) { // Counters only
+        std::cout << std::setprecision(0);
+        return;
+    }
+    std::cout << std::left << std::setw(10) << "Phase" << std::right << std::setw(14) << "Ticks/round"
+              << std::setw(12) << "ns/round" << std::setw(9) << "Share" << "\n";
+    for (int i = 0; i < NPHASE; ++i) {
+        std::cout << std::left << std::setw(10) << PHASENM[i] << std::right << std::setprecision(0)
+                  << std::setw(14) << ps.cyc[i] / rnds << std::setprecision(1) << std::setw(12) << ps.ns[i] / rnds
+                  << std::setw(8) << 100.0 * ps.ns[i] / totNs << "%\n";
+    }
+    std::cout << std::setprecision(0);
+}
+
+struct ShufJob; // Next shuffle being prepared off the table's thread
+
+// Table Structure
+// Everything one table needs to play, so independent tables can run
+// side by side (one per thread) without sharing any state
+struct Table {
+    Shoe deck;                     // Shoe of cards
+    Rng rng;                       // This table's own random stream
+    ShufAlg shufAlg = ShufAlg::FY; // Shuffle used by shufDk
+    EvtBuf* evts = nullptr;        // Optional event log for this table
+    RpBuf* rec = nullptr;          // Optional replay recording for this table
+    Count cnt;                     // Card count of the current shoe
+    Prof prof;                     // Hot-path counters and phase timings
+    ShufJob* ahd = nullptr;        // Shuffle-ahead slot, or null to shuffle inline
+};
+
+// Ends the current playRnd phase when phase timing is on
+inline void profPh(Table& tbl, int ph) {
+    if (PROF && tbl.prof.on) tbl.prof.phase(ph);
+}
+
+// True count: running count per deck still to be dealt. Unbalanced
+// systems are read by their running count instead.
+double trueCnt(const Table& tbl) {
+    if (!tbl.cnt.sys->bal) return tbl.cnt.run;
+    int left = tbl.deck.size(); // Cards left to deal
+    return left > 0 ? tbl.cnt.run * static_cast<double>(DKSIZE) / left : tbl.cnt.run;
+}
+
+// Strategy Interface
+// Supplies bets and decisions so a round can be driven without std::cin
+struct Strat {
+    virtual ~Strat() = default;
+    // Bet for a new round; must be between 1 and p.chips
+    virtual int getBet(const Player& p) = 0;
+    // Action for the current hand: 'H'it, 'S'tand, 'D'ouble Down, s'P'lit or su'R'render
+    virtual char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                        bool canSurr) = 0;
+};
+
+// Streaming Statistics
+// Welford's running mean and sum of squared deviations: one pass, stable
+// over billions of samples, and two accumulators merge exactly (Chan et
+// al.), so every thread keeps its own and they combine after join.
+struct RunStat {
+    long long n = 0; // Samples
+    double mean = 0.0; // Running mean
+    double m2 = 0.0; // Sum of squared deviations from the mean
+
+    void add(double x) {
+        ++n;
+        double d = x - mean;
+        mean += d / n;
+        m2 += d * (x - mean);
+    }
+
+    RunStat& operator+=(const RunStat& oth) {
+        if (oth.n == 0) return *this;
+        long long tot = n + oth.n;
+        double d = oth.mean - mean;
+        mean += d * oth.n / tot;
+        m2 += oth.m2 + d * d * (static_cast<double>(n) * oth.n / tot);
+        n = tot;
+        return *this;
+    }
+
+    double var() const { return n > 1 ? m2 / (n - 1) : 0.0; } // Sample variance
+    double sem() const { return n > 1 ? std::sqrt(var() / n) : 0.0; } // Standard error of the mean
+};
+
+const int MAXSEAT = 7; // Seats at a standard table
+const double Z95 = 1.959964; // Normal quantile for a two-sided 95% interval
+
+// Simulation Tally
+// Aggregate results collected by playRnd when running headless
+struct Tally {
+    long long rounds = 0; // Player-rounds played
+    long long hands = 0; // Hands settled (splits count separately)
+    long long wins = 0; // Hands won (including naturals)
+    long long losses = 0; // Hands lost (including busts)
+    long long pushes = 0; // Hands pushed
+    long long nats = 0; // Player natural blackjacks paid
+    long long wagered = 0; // Total chips bet, including doubles and splits
+    long long net = 0; // Net chips won by players
+    long long busts = 0; // Player hands busted
+    RunStat seat[MAXSEAT]; // Per-round net of each seat; merged they give the run's
+    // Per-round net of each table, averaged over its seats. Seats at one
+    // table share the dealer's hand and the shoe, so their results are
+    // correlated; the table's round is the independent sample for the
+    // interval on EV.
+    RunStat tblRnd;
+
+    // Per-round net over every seat, for the spread a single seat sees
+    RunStat all() const {
+        RunStat st;
+        for (const RunStat& s : seat) st += s;
+        return st;
+    }
+
+    // Merge another tally (e.g. from another thread) into this one
+    Tally& operator+=(const Tally& oth) {
+        rounds += oth.rounds;
+        hands += oth.hands;
+        wins += oth.wins;
+        losses += oth.losses;
+        pushes += oth.pushes;
+        nats += oth.nats;
+        wagered += oth.wagered;
+        net += oth.net;
+        busts += oth.busts;
+        for (int i = 0; i < MAXSEAT; ++i) seat[i] += oth.seat[i];
+        tblRnd += oth.tblRnd;
+        return *this;
+    }
+};
+
+// Rule Sets
+// House rules. The game functions are templates over the rule set type and
+// read every rule as rul.name, so the same code serves both kinds:
+// - a preset struct with static constexpr members, where each rule is a
+//   compile-time constant and its branches fold away in the hot loop
+// - RuleSet, with the same members set at run time, for one-off configs
+
+// The game's original rules: 4 decks, reshuffle under 60 cards, dealer
+// stands on soft 17, 3:2 naturals, double after split, one split
+struct RulStd {
+    static constexpr int decks = 4; // Decks in the shoe
+    static constexpr int cut = 60; // A round starts with a reshuffle below this many cards
+    static constexpr bool h17 = false; // Dealer hits soft 17
+    static constexpr int bjNum = 3; // Natural pays bjNum:bjDen
+    static constexpr int bjDen = 2;
+    static constexpr bool das = true; // Double after split
+    static constexpr int spltHnds = 2; // Most hands splitting can make (2 = no resplits)
+    static constexpr bool surr = false; // Late surrender
+    static constexpr bool enhc = false; // European no hole card
+};
+
+// Six decks, 75% penetration, dealer hits soft 17, resplit to four hands,
+// late surrender
+struct RulVegas {
+    static constexpr int decks = 6;
+    static constexpr int cut = 78;
+    static constexpr bool h17 = true;
+    static constexpr int bjNum = 3;
+    static constexpr int bjDen = 2;
+    static constexpr bool das = true;
+    static constexpr int spltHnds = 4;
+    static constexpr bool surr = true;
+    static constexpr bool enhc = false;
+};
+
+// Six decks, dealer stands on soft 17 and takes no hole card until the
+// players have acted, so doubles and splits are lost to a dealer natural
+struct RulEuro {
+    static constexpr int decks = 6;
+    static constexpr int cut = 78;
+    static constexpr bool h17 = false;
+    static constexpr int bjNum = 3;
+    static constexpr int bjDen = 2;
+    static constexpr bool das = true;
+    static constexpr int spltHnds = 2;
+    static constexpr bool surr = false;
+    static constexpr bool enhc = true;
+};
+
+// Runtime Rule Set
+// Same members as the presets, chosen at run time
+struct RuleSet {
+    int decks = RulStd::decks;
+    int cut = RulStd::cut;
+    bool h17 = RulStd::h17;
+    int bjNum = RulStd::bjNum;
+    int bjDen = RulStd::bjDen;
+    bool das = RulStd::das;
+    int spltHnds = RulStd::spltHnds;
+    bool surr = RulStd::surr;
+    bool enhc = RulStd::enhc;
+};
+
+// Copies any rule set into a RuleSet
+template <class R>
+RuleSet toRules(const R& rul) {
+    RuleSet rs;
+    rs.decks = rul.decks;
+    rs.cut = rul.cut;
+    rs.h17 = rul.h17;
+    rs.bjNum = rul.bjNum;
+    rs.bjDen = rul.bjDen;
+    rs.das = rul.das;
+    rs.spltHnds = rul.spltHnds;
+    rs.surr = rul.surr;
+    rs.enhc = rul.enhc;
+    return rs;
+}
+
+static_assert(RulStd::spltHnds <= MAXHNDS && RulVegas::spltHnds <= MAXHNDS && RulEuro::spltHnds <= MAXHNDS,
+              "Preset split limit exceeds the hand capacity");
+
+// Checks a runtime rule set; throws std::invalid_argument if it is unusable
+void chkRules(const RuleSet& rs) {
+    if (rs.decks < 1 || rs.decks > MAXDK) {
+        throw std::invalid_argument("Number of decks must be between 1 and " + std::to_string(MAXDK));
+    }
+    if (rs.cut < 0 || rs.cut >= rs.decks * DKSIZE) throw std::invalid_argument("Cut card must be inside the shoe");
+    if (rs.bjNum < 0 || rs.bjDen < 1) throw std::invalid_argument("Natural payout must be a ratio like 3:2");
+    if (rs.spltHnds < 1 || rs.spltHnds > MAXHNDS) {
+        throw std::invalid_argument("Split limit must be between 1 and " + std::to_string(MAXHNDS) + " hands");
+    }
+}
+
+// Function Prototypes Here
+
+// Clear input buffer
+void clear_in() {
+    std::cin.clear(); // Clear any error flags
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Discard invalid input
+}
+
+// Scoring Functions
+// Calculates the best Blackjack score for a hand.
+// The hand keeps running totals, so this is a field read.
+int calcScr(const Hand& hand) {
+    return hand.score(); // Final score (0 for an empty hand)
+}
+
+// Checks if a hand is soft (one Ace is counting as 11).
+bool isSoft(const Hand& hand) {
+    return hand.soft;
+}
+
+// Checks if a hand is a natural Blackjack (21 with 2 cards).
+bool is_nat(const Hand& hand) {
+    // Natural only if 2 cards and not a split hand
+    return calcScr(hand) == 21 && hand.cards.size() == 2 && !hand.isplit;
+}
+
+// Deck Management
+// Creates a standard deck with the specified number of decks.
+void createDk(Table& tbl, int num_dk) { // Number of decks to create
+    if (num_dk < 1 || num_dk > MAXDK) { // Shoe buffer has a fixed capacity
+        throw std::invalid_argument("Number of decks must be between 1 and " + std::to_string(MAXDK));
+    }
+    tbl.deck.clear(); // Clear existing deck and discard region
+
+    // Nested loops to create the deck(s)
+    for (int d = 0; d < num_dk; ++d) {
+        // Nested iteration over rank and suit codes
+        for (int rnk = 0; rnk < NRANKS; ++rnk) {
+            for (int st = 0; st < NSUITS; ++st) {
+                tbl.deck.push(Card(rnk, st)); // Add to deck
             }
-        } // end while (!done_playing)
+        }
+    }
+}
+
+// Uniform Fisher-Yates shuffle of n cards in O(n)
+template <class T>
+void shufFY(T* crds, int n, Rng& g) {
+    for (int i = n - 1; i > 0; --i) { // Walk down from the last card
+        int j = static_cast<int>(g.below(i + 1)); // Random card in [0, i]
+        std::swap(crds[i], crds[j]); // Fix card i in place
+    }
+}
+
+// Legacy shuffle: repeatedly moves a random card to a random position
+// (std::rotate on the buffer); O(n^2) and not provably uniform.
+// Kept for comparison benchmarks and reproducing older runs.
+template <class T>
+void shufLgcy(T* crds, int n, Rng& g) {
+    std::mt19937 mt(static_cast<unsigned>(g.next())); // Per-call engine as before
+
+    // Custom move-based shuffle
+    for (int i = 0; i < n * 2; ++i) { // Shuffle iterations n*2
+        int frmPos = mt() % n; // Position to take a card from
+        int trgPos = mt() % n; // Position the card ends up at
+
+        // Slide the cards in between by one to close the gap and open the target
+        if (frmPos < trgPos) {
+            std::rotate(crds + frmPos, crds + frmPos + 1, crds + trgPos + 1);
+        } else if (frmPos > trgPos) {
+            std::rotate(crds + trgPos, crds + frmPos, crds + frmPos + 1);
+        }
+    }
+}
+
+// Shuffle-Ahead
+// Both shuffles only draw positions from the table's stream and never
+// look at the cards, so the permutation for a table's next reshuffle can
+// be drawn on a background thread while the table plays. At the cut card
+// the table applies it with one gather over the shoe. A job remembers the
+// stream state it started from, and is only used when that still matches
+// the table's stream and shoe size; otherwise (mid-round reshuffles, a
+// resumed checkpoint) the table shuffles inline. Either way the shoe and
+// the stream end up exactly as an inline shuffle would leave them.
+
+// Job states
+enum ShufSt { SJ_IDLE, SJ_QUEUED, SJ_BUSY, SJ_READY };
+
+struct ShufPool;
+
+// One table's pending shuffle
+struct ShufJob {
+    std::atomic<int> st{SJ_IDLE}; // ShufSt; whoever moves it QUEUED -> BUSY draws the permutation
+    ShufPool* pool; // Shuffler that prepares this job
+    Rng in; // Table stream the permutation starts from
+    Rng out; // Stream after drawing it
+    int n = 0; // Cards the permutation covers
+    ShufAlg alg = ShufAlg::FY; // Shuffle it was drawn with
+    uint16_t perm[MAXDK * DKSIZE]; // Position i of the shuffled shoe takes card perm[i]
+
+    explicit ShufJob(ShufPool* pl) : pool(pl) {}
+
+    // Draws the permutation from in; the caller holds the job in SJ_BUSY
+    void draw() {
+        for (int i = 0; i < n; ++i) perm[i] = static_cast<uint16_t>(i); // Identity, then shuffle the positions
+        out = in;
+        if (alg == ShufAlg::LEGACY) shufLgcy(perm, n, out);
+        else shufFY(perm, n, out);
+        st.store(SJ_READY, std::memory_order_release);
+    }
+};
+
+// Shuffler Pool
+// Background thread preparing the next shuffle for any number of tables.
+// Jobs are created once per table and re-queued after every reshuffle.
+// The queue has no fixed bound (a table that keeps shuffling inline
+// before the shuffler wakes posts its job again each time), but both
+// queue buffers keep their capacity, so a warm pool stops allocating. A
+// table that reaches its cut card before the shuffler got to its job
+// draws the permutation itself.
+struct ShufPool {
+    std::vector<std::unique_ptr<ShufJob>> jobs; // Every table's job
+    std::vector<ShufJob*> que; // Jobs waiting for the shuffler
+    std::mutex mtx; // Guards the queue
+    std::condition_variable cv; // Signals new jobs or shutdown
+    bool done = false; // Set when the pool is closing
+    std::thread wrkr; // Background shuffler
+
+    ShufPool() { wrkr = std::thread([this]() { drain(); }); }
+
+    ~ShufPool() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            done = true;
+        }
+        cv.notify_all();
+        wrkr.join();
+    }
+
+    // Gives the table a shuffle-ahead slot
+    void join(Table& tbl) {
+        std::lock_guard<std::mutex> lk(mtx);
+        jobs.emplace_back(new ShufJob(this));
+        tbl.ahd = jobs.back().get();
+    }
+
+    // Queues the job for the permutation following the table's stream
+    void post(ShufJob& j, const Table& tbl) {
+        j.in = tbl.rng;
+        j.n = tbl.deck.len;
+        j.alg = tbl.shufAlg;
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            j.st.store(SJ_QUEUED, std::memory_order_release);
+            que.push_back(&j); // May already hold j from an earlier post; drain skips entries not QUEUED
+        }
+        cv.notify_one();
+    }
+
+    // Shuffler thread: draws queued permutations until closed
+    void drain() {
+        std::vector<ShufJob*> batch; // Jobs taken from the queue in one go
+        std::unique_lock<std::mutex> lk(mtx);
+        for (;;) {
+            cv.wait(lk, [this]() { return done || !que.empty(); });
+            if (done) break;
+            batch.swap(que);
+            lk.unlock();
+            for (ShufJob* j : batch) {
+                int exp = SJ_QUEUED;
+                if (j->st.compare_exchange_strong(exp, SJ_BUSY, std::memory_order_acquire)) j->draw();
+            }
+            batch.clear();
+            lk.lock();
+            que.reserve(batch.capacity()); // Keep both buffers warm
+        }
+    }
+};
+
+// Applies the table's prepared shuffle to the shoe; false when there is
+// none or it no longer matches the table's stream and shoe
+bool shufTake(Table& tbl) {
+    ShufJob& j = *tbl.ahd;
+    int cur = j.st.load(std::memory_order_acquire);
+    if (cur == SJ_IDLE) return false;
+    if (cur == SJ_QUEUED && j.st.compare_exchange_strong(cur, SJ_BUSY, std::memory_order_acquire)) {
+        j.draw(); // The shuffler has not got to it yet
+    }
+    while (j.st.load(std::memory_order_acquire) != SJ_READY) std::this_thread::yield(); // Being drawn
+    j.st.store(SJ_IDLE, std::memory_order_relaxed);
+    if (j.n != tbl.deck.size() || j.alg != tbl.shufAlg || std::memcmp(j.in.s, tbl.rng.s, sizeof(j.in.s)) != 0) {
+        return false; // Stale: the shoe or stream changed since it was posted
+    }
+    Card tmp[MAXDK * DKSIZE]; // Shuffled copy of the shoe
+    const Card* src = tbl.deck.begin();
+    for (int i = 0; i < j.n; ++i) tmp[i] = src[j.perm[i]];
+    std::memcpy(tbl.deck.begin(), tmp, j.n);
+    tbl.rng = j.out; // As if the table had drawn it
+    return true;
+}
+
+// Shuffles the cards left in the shoe with the run's selected algorithm
+void shufDk(Table& tbl) {
+    tbl.cnt.reset(tbl.deck.len / DKSIZE); // A fresh shoe starts a fresh count
+    if (tbl.deck.empty()) return; // Don't shuffle an empty deck
+
+    if (tbl.ahd && shufTake(tbl)) {
+        // Prepared off the table's thread
+    } else if (tbl.shufAlg == ShufAlg::LEGACY) {
+        shufLgcy(tbl.deck.begin(), tbl.deck.size(), tbl.rng);
+    } else { // A CSM starts from a Fisher-Yates shoe
+        shufFY(tbl.deck.begin(), tbl.deck.size(), tbl.rng);
+    }
+    if (tbl.ahd && tbl.shufAlg != ShufAlg::CSM) tbl.ahd->pool->post(*tbl.ahd, tbl); // Start on the next one
+}
+
+// Deals a card from the deck to the hand, reshuffling if necessary
+// Dealing only advances the shoe's cursor
+// Loud selects console output; when false all printing is compiled out
+// faceUp = false holds the card out of the count until it is revealed
+template <bool Loud>
+void dealCrd(Table& tbl, Hand& trgHnd, bool faceUp = true) { // Target hand to receive card
+    // Reshuffle if deck is empty
+    if (tbl.deck.empty()) {
+        if (Loud) std::cout << "\n--- Reshuffling Discard Pile ---\n";
         
-        // Handle iterator progression after hand completion
-        if (split) {
-            // After a split, stay on the current iterator to play the new hand next
-            // 'it' already points to the original hand; increment to the new hand
+        // Turn the discard region back into dealable cards
+        tbl.deck.rcyl(); // Bulk move; cards in hands stay out
+        shufDk(tbl); // Shuffle the deck
+        if (PROF) ++tbl.prof.cur.shufs;
+        if (tbl.evts) tbl.evts->put(EV_SHUF, 0, 0, 1, 0, tbl.deck.size());
+        if (tbl.deck.empty()) { // Still empty after reshuffle
+             throw std::runtime_error("No cards left to deal or shuffle!");
+        }
+    }
+    
+    // Take the card under the deal cursor
+    Card c = tbl.deck.deal();
+    trgHnd.add(c);
+    if (tbl.rec) tbl.rec->crd(c);
+    if (faceUp) tbl.cnt.see(c); // Running count
+    else tbl.cnt.holeDn = true;
+    if (tbl.evts) tbl.evts->put(EV_DEAL, trgHnd.seat, trgHnd.idx, c.code, trgHnd.score(), 0);
+}
+
+// Moves all cards from a Hand to the shoe's discard region, or with a
+// CSM straight back into the shoe.
+void discHnd(Table& tbl, Hand& hand) {
+    if (tbl.shufAlg == ShufAlg::CSM) {
+        for (const Card& c : hand.cards) {
+            tbl.deck.rein(c, tbl.rng);
+            tbl.cnt.unsee(c); // The count covers only cards out of the shoe
+        }
+    } else {
+        // STL Algorithm: std::for_each to iterate and record each discard
+        std::for_each(hand.cards.begin(), hand.cards.end(), [&](const Card& c) {
+            tbl.deck.disc(c); // One byte into the discard region
+        });
+    }
+    hand.clrCrds(); // List clear and totals reset
+    hand.bet = 0; // Reset bet
+}
+
+// Frame Output
+// Redirects a stream into one preallocated buffer that reaches the real
+// stream in a single write when it is flushed. std::cin is tied to
+// std::cout, so everything printed since the last prompt (the table after
+// each action) is written as one frame just before the game waits for
+// input, rather than fragment by fragment.
+struct FrameBuf : std::streambuf {
+    std::vector<char> buf; // Frame being assembled
+    std::ostream& os; // Stream redirected into the buffer
+    std::streambuf* prev; // Its own buffer, which receives whole frames
+
+    explicit FrameBuf(std::ostream& o, size_t cap = 1 << 16) : buf(cap), os(o), prev(o.rdbuf(this)) {
+        setp(buf.data(), buf.data() + buf.size());
+    }
+    ~FrameBuf() {
+        sync();
+        os.rdbuf(prev);
+    }
+
+    // Writes the frame out in one piece
+    int sync() override {
+        std::streamsize n = pptr() - pbase();
+        if (n > 0 && prev->sputn(pbase(), n) != n) return -1;
+        setp(buf.data(), buf.data() + buf.size());
+        return prev->pubsync();
+    }
+
+    // A frame larger than the buffer goes out in buffer-sized pieces
+    int_type overflow(int_type ch) override {
+        if (sync() != 0) return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+};
+
+// Display Functions
+// Print hand, optionally hiding second card
+
+void prntHnd(const Hand& hand, bool hide_1 = false) {
+    std::cout << "[ "; // Start hand display
+    int count = 0; // Card counter
+    
+    // Iterator: pointer into the inline card array
+    for (auto it = hand.cards.cbegin(); it != hand.cards.cend(); ++it) {
+        // Hide second card if specified
+        if (hide_1 && count == 1) {
+            // Hidden card representation
+            std::cout << "XX ";
         } else {
-            // Normal progression: move to the next hand in the list
-            ++it;
+            std::cout << *it << " "; // Use overloaded operator
+        }
+        count++; // Increment card counter
+    }
+    std::cout << "]";
+}
+
+// Print player statistics and hands
+void prntStat(const Player& p, bool inclHnd = true) {
+    // Player header display with chips
+    std::cout << "\n**Player " << p.id << " (" << p.name << ")** - Chips: $" << p.chips << "\n";
+    // Include the hand details
+    if (inclHnd) {
+        int hndCnt = 1; // Hand counter
+        // Iterator: Iterate over all hands
+        for (const auto& hand : p.hands) {
+            int score = calcScr(hand); // Calculate hand score
+            std::cout << "  Hand " << hndCnt++; // Hand number
+            if (hand.isplit) std::cout << " (Split)"; // Indicate split hand
+            if (hand.ddown) std::cout << " (DD)"; // Indicate double down hand
+            std::cout << " Bet: $" << hand.bet << " Score: (" << score << "): ";
+            prntHnd(hand, false); // Print hand cards
+            std::cout << "\n";
+        }
+    }
+}
+
+// Game Logic Functions
+
+// Handles the "Hit" action for a specific hand.
+// Reference to hand to modify
+template <bool Loud>
+void playHit(Table& tbl, Hand& hand) {
+    if (Loud) std::cout << "Player hits. Dealing card.\n";
+    dealCrd<Loud>(tbl, hand); // Deal card to hand
+}
+
+// Handles the "Split" action for a player.
+// Inserts the new hand right after curIt in the player's hands array.
+template <bool Loud>
+void playSplt(Table& tbl, Player& p, Hand* curIt) {
+    Hand& origHnd = *curIt; // Reference to the original hand
+    
+    // Check if splitting is valid (two cards of the same rank)
+    if (origHnd.cards.size() != 2 || origHnd.cards.front().rank() != origHnd.cards.back().rank()) { // Invalid split
+        if (Loud) std::cout << "Cannot split this hand.\n";
+        return;
+    }
+
+    // Check if player has enough chips to place the second bet
+    if (p.chips < origHnd.bet) {
+        if (Loud) std::cout << "Not enough chips to place a second bet for splitting.\n";
+        return;
+    }
+
+    // Proceed with split
+    if (Loud) std::cout << "Splitting Hand. Placing additional $" << origHnd.bet << " bet.\n";
+
+    // Create the new hand (the second split hand)
+    Hand newHnd; // New hand for the split
+    newHnd.bet = origHnd.bet; // Same bet as original hand
+    newHnd.isplit = true; // Mark as split hand
+    origHnd.isplit = true; // The original hand is now a split hand too
+    
+    // Move the second card from the original hand to the new hand
+    newHnd.add(origHnd.popCrd()); // Totals follow the card
+
+    // Insert the new hand *after* the original hand in the player's hands array
+    // This allows the player to play the hands sequentially (original first, then new)
+    // insert() places the hand before the given position, so pass the one
+    // after the original; only later hands shift, so curIt stays valid
+    p.hands.insert(std::next(curIt), newHnd); // Insert new hand
+    for (int i = 0; i < p.hands.size(); ++i) p.hands[i].idx = static_cast<uint8_t>(i); // Renumber for the log
+    
+    // Update chip count and deal second cards
+    p.chips -= newHnd.bet;
+    if (PROF) ++tbl.prof.cur.splits;
+    
+    // Deal the second card to the original hand
+    dealCrd<Loud>(tbl, origHnd);
+    
+    // Deal the second card to the new hand (now located one position forward)
+    dealCrd<Loud>(tbl, *std::next(curIt));
+
+    if (Loud) std::cout << "Split successful. Playing the first hand...\n";
+}
+
+// Handles the "Double Down" action for a player.
+template <bool Loud>
+void playDD(Table& tbl, Player& p, Hand& hand) { // Reference to player and hand
+    // Check if Double Down is valid (only on initial two cards)
+    if (hand.cards.size() != 2) { // If not initial two cards
+        if (Loud) std::cout << "Double Down only allowed on initial two cards.\n";
+        return;
+    }
+    if (p.chips < hand.bet) { // If not enough chips
+        if (Loud) std::cout << "Not enough chips to Double Down.\n";
+        return;
+    }
+
+    // Proceed with Double Down and output
+    if (Loud) std::cout << "Player Doubles Down! Betting an additional $" << hand.bet << ".\n";
+    p.chips -= hand.bet; // Deduct additional bet
+    hand.bet *= 2; // Double the bet
+    hand.ddown = true; // Mark hand as double down
+    if (PROF) ++tbl.prof.cur.dbls;
+    
+    // Player gets exactly one card
+    playHit<Loud>(tbl, hand);
+    
+    // Show final hand and output score
+    if (Loud) {
+        std::cout << "Final Hand Score: (" << calcScr(hand) << ")\n";
+        prntHnd(hand);
+        std::cout << "\n";
+    }
+}
+
+// Processes the outcome of a single hand against the dealer.
+// Updates player chips based on the result.
+// References to player, player's hand, and dealer's hand
+// Returns the net chips won (+) or lost (-) on this hand
+template <bool Loud, class R>
+int setHnd(Table& tbl, Player& p, Hand& hand, const Hand& dlHnd, const R& rul) {
+    int p_score = calcScr(hand); // Player's hand score
+    int d_score = calcScr(dlHnd); // Dealer's hand score
+    int net = 0; // Net result for this hand
+    char res; // Outcome letter for the event log
+
+    // Output settlement header
+    if (Loud) std::cout << "\n--- Settlement for " << p.name << "'s hand (Score: " << p_score << ") ---\n";
+
+    // Surrendered: half the bet back (chips already deducted at bet time)
+    if (rul.surr && hand.surr) {
+        int back = hand.bet / 2; // Refund, rounded down
+        if (Loud) std::cout << "Hand was surrendered. $" << back << " of $" << hand.bet << " returned.\n";
+        p.chips += back;
+        net = back - hand.bet;
+        res = 'R';
+    }
+    // Player bust
+    else if (p_score > 21) {  // If score is over 21
+        if (Loud) std::cout << "Player BUSTS. Bet of $" << hand.bet << " lost.\n";
+        // Chips already deducted at bet time
+        net = -hand.bet;
+        res = 'B';
+        if (PROF) ++tbl.prof.cur.busts;
+    }
+    // Both have naturals
+    else if (is_nat(hand) && is_nat(dlHnd)) {
+        if (Loud) std::cout << "PUSH (Natural vs. Natural). Bet of $" << hand.bet << " returned.\n";
+        p.chips += hand.bet; // Return original bet
+        res = 'P';
+    }
+    // Natural blackjack for player
+    else if (is_nat(hand)) {
+        int winAmt = hand.bet * rul.bjNum / rul.bjDen; // 3:2 by default, rounded down
+        if (Loud) std::cout << "NATURAL BLACKJACK! Pays " << rul.bjNum << ":" << rul.bjDen << ". $" << winAmt << " won (Total return: $" << hand.bet + winAmt << ").\n";
+        p.chips += hand.bet + winAmt; // Return original bet + winnings
+        net = winAmt;
+        res = 'N';
+    }
+    // Dealer bust
+    else if (d_score > 21) { // If score is over 21 for dealer
+        if (Loud) std::cout << "Dealer BUSTS (" << d_score << "). Player wins $" << hand.bet << ".\n";
+        p.chips += hand.bet * 2; // Return original bet + winnings
+        net = hand.bet;
+        res = 'W';
+    }
+    // Dealer has natural blackjack
+    else if (is_nat(dlHnd)) {
+        if (Loud) std::cout << "Dealer has NATURAL BLACKJACK. Bet of $" << hand.bet << " lost.\n";
+        net = -hand.bet;
+        res = 'L';
+    }
+    // Compare scores
+    else if (p_score > d_score) { // Player wins
+        if (Loud) std::cout << "Player Wins (" << p_score << " > " << d_score << "). Wins $" << hand.bet << ".\n";
+        p.chips += hand.bet * 2; // Return original bet + winnings
+        net = hand.bet;
+        res = 'W';
+    }
+    else if (p_score < d_score) { // Dealer wins
+        if (Loud) std::cout << "Dealer Wins (" << d_score << " > " << p_score << "). Bet of $" << hand.bet << " lost.\n";
+        net = -hand.bet;
+        res = 'L';
+    }
+    else { // Push
+        if (Loud) std::cout << "PUSH (" << p_score << " vs. " << d_score << "). Bet of $" << hand.bet << " returned.\n";
+        p.chips += hand.bet; // Return original bet
+        res = 'P';
+    }
+
+    if (tbl.evts) tbl.evts->put(EV_SETL, hand.seat, hand.idx, res, p_score, net);
+    discHnd(tbl, hand);
+    return net; // Net result for the tally
+}
+
+
+// Game Logic Functions
+
+// Round State
+// Where a round stands between calls to stepRnd. A strategy may answer a
+// bet or decision with 0 to mean "not yet" (e.g. a network player who has
+// not replied); stepRnd then returns and a later call carries on from here.
+// Together with the cards and bets already in the hands, RndSt is the
+// whole of the round's progress: the round runs
+//   OPEN -> BET(seat) -> DEAL -> ACT(seat, hand) -> DLR -> SETL -> DONE
+// and a scheduler can keep thousands of suspended rounds as plain
+// structs, copy them, or step them in any order, with no thread or stack
+// per table.
+enum RndPh : uint8_t { RP_OPEN, RP_BET, RP_DEAL, RP_ACT, RP_DLR, RP_SETL, RP_DONE };
+
+struct RndSt {
+    RndPh ph = RP_OPEN; // Phase to run next
+    int seat = 0; // Player betting or acting, by position in the player list
+    int hand = 0; // Hand that player is playing
+    bool inHnd = false; // That hand's opening checks are done
+    bool dNat = false; // Dealer holds a natural
+    long long alloc0 = 0; // Allocations before the round, for the profile
+};
+static_assert(std::is_trivially_copyable<RndSt>::value, "RndSt must stay a plain struct");
+static_assert(sizeof(RndSt) <= 24, "RndSt must stay compact");
+
+// Handles the main player decision phase (Hit, Stand, Split, Double Down)
+// from hand st.hand on. Decisions come from the strategy; Loud selects
+// console output. Returns false, with st at the waiting hand, if the
+// strategy has no decision yet.
+template <bool Loud, class R>
+bool hdlPlay(Table& tbl, Player& p, Hand& dlHnd, Strat& strat, const R& rul, RndSt& st) {
+    // Index into the array of hands, which grows when a hand is split
+    while (st.hand < p.hands.size()) { // While there are hands to play
+        Hand& curHnd = p.hands[st.hand]; // Reference to current hand
+        bool done = false; // Flag to indicate if done playing this hand
+
+        if (!st.inHnd) { // Arriving at this hand
+            // Output current hand header
+            if (Loud) std::cout << "\n--- " << p.name << "'s Turn (Hand Bet: $" << curHnd.bet << ") ---\n";
+
+            // Skip hands that were just completed by a Double Down
+            if (curHnd.ddown) {
+                ++st.hand; // Move to the next hand
+                continue;
+            }
+
+            // Handle split Aces (the first card of a split hand is the pair card)
+            if (curHnd.isplit && curHnd.cards.size() == 2 && curHnd.cards.front().isAce()) {
+                if (Loud) std::cout << "Split Aces: Only one card is dealt to each. Must stand.\n";
+                ++st.hand; // Move to the next hand after standing
+                continue;
+            }
+            st.inHnd = true;
+        }
+
+        // Inner loop for playing the current hand
+        bool split = false;
+
+        // Loop until the player stands, busts, or completes the hand
+        while (!done) {
+            int score = calcScr(curHnd); // Calculate current hand score
+            if (Loud) {
+                std::cout << "Current Hand Score (" << score << "): ";
+                prntHnd(curHnd); // Print current hand
+                std::cout << "\n";
+            }
+
+            // Check for bust or 21
+            if (score > 21) { // If score exceeds 21
+                if (Loud) std::cout << "Hand Busted!\n";
+                break;
+            }
+            if (score == 21) { // If score is exactly 21
+                if (Loud) std::cout << "Hand is 21! Standing.\n";
+                break;
+            }
+
+            // Check if Split, Double Down and Surrender are available
+            // Can split if two cards of same rank and the split limit allows another hand
+            bool canSplt = (curHnd.cards.size() == 2 && curHnd.cards.front().rank() == curHnd.cards.back().rank()
+                            && p.hands.size() < rul.spltHnds);
+            // Can double down on two cards with enough chips (after a split only with DAS)
+            bool canDbl = (curHnd.cards.size() == 2 && p.chips >= curHnd.bet && (rul.das || !curHnd.isplit));
+            // Can surrender the first two cards of an unsplit hand
+            bool canSurr = rul.surr && curHnd.cards.size() == 2 && !curHnd.isplit;
+
+            // Strategy chooses action
+            char choice = strat.getAct(p, curHnd, dlHnd.cards.front(), canSplt, canDbl, canSurr);
+            if (choice == 0) return false; // No decision yet: resume at this hand
+            if (tbl.evts) tbl.evts->put(EV_ACT, curHnd.seat, curHnd.idx, choice, score, 0);
+            if (tbl.rec) tbl.rec->act(choice);
+
+            // Handle player choice
+            if (choice == 'H') { // Hit
+                playHit<Loud>(tbl, curHnd); // Deal card to hand
+            } else if (choice == 'S') { // Stand
+                done = true; // End turn for this hand
+            } else if (choice == 'D' && canDbl) { // Double Down
+                playDD<Loud>(tbl, p, curHnd); // Handle Double Down
+                done = true; // Double Down ends the turn for this hand
+            } else if (choice == 'R' && canSurr) { // Surrender
+                if (Loud) std::cout << "Player surrenders half the bet.\n";
+                curHnd.surr = true;
+                done = true;
+            } else if (choice == 'P' && canSplt) {
+                // The player_split function inserts the new hand right after this one
+                playSplt<Loud>(tbl, p, &curHnd);
+                split = true; // Mark that a split occurred
+                break;
+            } else {
+                if (Loud) std::cout << "Invalid or unavailable action.\n"; // Prompt again
+            }
+        } // end while (!done_playing)
+
+        // Handle index progression after hand completion
+        if (!split) {
+            // Normal progression: move to the next hand in the array
+            // After a split, stay on the current hand, which now has its new second card
+            ++st.hand;
+        }
+        st.inHnd = false;
+    } // end while (st.hand < p.hands.size())
+    return true;
+}
+
+// Advances a round of Blackjack for all players and the dealer from st.
+// Bets and actions come from the strategy; results are added to tly if
+// given. Returns true once the round is settled, or false when the
+// strategy is still waiting on a bet or decision; calling again with the
+// same st picks up where it stopped.
+template <bool Loud, class R>
+bool stepRnd(Table& tbl, PlyrReg& plyrs, Player& dealr, Strat& strat, const R& rul, RndSt& st,
+             Tally* tly = nullptr) {
+    Hand& dealrH = dealr.hands.front(); // Dealer's hand
+    for (;;) {
+        switch (st.ph) {
+        case RP_OPEN: {
+            st.alloc0 = PROF ? allocCnt() : 0; // Allocations before the round
+            if (PROF && tbl.prof.on) tbl.prof.mark = profTick(); // The bets phase starts here
+
+            // Bets and Initial Deal
+            if (Loud) {
+                std::cout << "\n" << std::string(50, '=') << "\n"; // Round header
+                std::cout << "                NEW ROUND STARTING\n";
+                std::cout << std::string(50, '=') << "\n";
+            }
+
+            if (tbl.evts) tbl.evts->rnd++; // Stamp this round's events
+
+            // Reshuffle check
+            if (tbl.deck.size() < rul.cut && tbl.shufAlg != ShufAlg::CSM) { // Reached the cut card
+                if (Loud) std::cout << "Deck size (" << tbl.deck.size() << ") is low. Performing full reshuffle.\n";
+                tbl.deck.rcyl(); // Discards rejoin the shoe in place
+                shufDk(tbl); // Shuffle the deck
+                if (PROF) ++tbl.prof.cur.shufs;
+                if (tbl.evts) tbl.evts->put(EV_SHUF, 0, 0, 0, 0, tbl.deck.size());
+            }
+            if (Loud) {
+                std::cout << std::setprecision(1) << "Running count (" << tbl.cnt.sys->name << "): " << tbl.cnt.run
+                          << "  True count: " << trueCnt(tbl) << "\n" << std::setprecision(0);
+            }
+            if (tbl.rec) tbl.rec->begin(tbl.deck.pos); // After any reshuffle
+            st.seat = 0;
+            st.ph = RP_BET;
+            break;
+        }
+
+        case RP_BET: {
+            // Place Bets; the turn order is the order of the player list
+            for (; st.seat < plyrs.size(); ++st.seat) {
+                Player& p = plyrs.nth(st.seat);
+                int betAmt = strat.getBet(p); // Bet amount from strategy
+                if (betAmt == 0) return false; // No bet yet: resume at this player
+                if (tbl.rec) tbl.rec->bet(p, betAmt);
+
+                // Set up player's initial hand and deduct chips
+                p.hands.emplace_back(); // Add initial hand
+                p.hands.front().bet = betAmt; // Set bet for the hand
+                p.hands.front().seat = static_cast<uint8_t>(p.id); // Owner for the event log
+                p.chips -= betAmt; // Deduct bet from chips
+            }
+            profPh(tbl, PH_BET);
+            st.ph = RP_DEAL;
+            break;
+        }
+
+        case RP_DEAL: {
+            // Initial Deal (Player, Dealer, Player, Dealer)
+            if (Loud) std::cout << "\n--- Initial Deal ---\n";
+            // Deal card 1 to all players (in order)
+            for (auto& p : plyrs) dealCrd<Loud>(tbl, p.hands.front()); // Deal to player's first hand
+            // Deal card 1 to dealer
+            dealCrd<Loud>(tbl, dealrH);
+
+            // Deal card 2 to all players
+            for (auto& p : plyrs) dealCrd<Loud>(tbl, p.hands.front());
+            // Deal card 2 to dealer (with no hole card it comes after the players act)
+            if (!rul.enhc) dealCrd<Loud>(tbl, dealrH, false); // Dealer's hole card, face down
+
+            // Display initial hands
+            if (Loud) {
+                std::cout << "\nDealer's upcard: ";
+                prntHnd(dealrH, true); // Hide the second card
+                std::cout << "\n";
+            }
+
+            // Check for naturals
+            st.dNat = !rul.enhc && is_nat(dealrH); // Check if dealer has natural (needs the hole card)
+
+            if (st.dNat) {
+                if (Loud) std::cout << "\n**DEALER NATURAL BLACKJACK!**\n";
+            }
+            profPh(tbl, PH_DEAL);
+            st.seat = 0;
+            st.hand = 0;
+            st.inHnd = false;
+            st.ph = RP_ACT;
+            break;
+        }
+
+        case RP_ACT: {
+            // Player Actions Phase: player st.seat, hand st.hand
+            for (; st.seat < plyrs.size(); ++st.seat) {
+                Player& p = plyrs.nth(st.seat);
+
+                // If dealer has natural, only check for push, otherwise players play
+                if (!st.dNat) {
+                    if (!hdlPlay<Loud>(tbl, p, dealrH, strat, rul, st)) return false; // Waiting on this player
+                } else {
+                    if (Loud) std::cout << "\n" << p.name << ": Dealer has a Natural. Skip action phase.\n";
+                }
+                st.hand = 0;
+            }
+            profPh(tbl, PH_ACT);
+            st.ph = RP_DLR;
+            break;
+        }
+
+        case RP_DLR: {
+            // Dealer Play
+            if (Loud) {
+                std::cout << "\n" << std::string(50, '-') << "\n";
+                std::cout << "               DEALER'S PLAY\n";
+                std::cout << std::string(50, '-') << "\n";
+            }
+
+            if (rul.enhc) { // The dealer's second card, dealt face up
+                if (Loud) std::cout << "Dealer draws a second card.\n";
+                dealCrd<Loud>(tbl, dealrH);
+                st.dNat = is_nat(dealrH); // A natural now beats every hand but a natural
+            }
+            int d_score = calcScr(dealrH); // Dealer's initial score
+            if (tbl.cnt.holeDn) { // Hole card joins the count (unless the shoe was reshuffled under it)
+                tbl.cnt.see(dealrH.cards[1]);
+                tbl.cnt.holeDn = false;
+            }
+            if (Loud) {
+                std::cout << (rul.enhc ? "Dealer's Hand (" : "Dealer reveals hole card. Full Hand (") << d_score << "): ";
+                prntHnd(dealrH); // Print dealer's full hand
+                std::cout << "\n";
+            }
+
+            if (!st.dNat) { // Only play if dealer doesn't have natural
+                while (d_score < 17 || (rul.h17 && d_score == 17 && isSoft(dealrH))) { // Hit below 17, and soft 17 under H17
+                    if (Loud) std::cout << "Dealer Hits (" << d_score << ").\n";
+                    dealCrd<Loud>(tbl, dealrH); // Deal card to dealer
+                    d_score = calcScr(dealrH); // Recalculate score
+                    if (Loud) {
+                        std::cout << "Dealer's Hand (" << d_score << "): ";
+                        prntHnd(dealrH); // Print dealer's hand
+                        std::cout << "\n";
+                    }
+                }
+                if (Loud) std::cout << "Dealer Stands at " << d_score << ".\n";
+            }
+            profPh(tbl, PH_DLR);
+            st.ph = RP_SETL;
+            break;
+        }
+
+        case RP_SETL: {
+            // Final Settlement Phase
+            if (Loud) {
+                std::cout << "\n" << std::string(50, '-') << "\n";
+                std::cout << "               FINAL SETTLEMENT\n";
+                std::cout << std::string(50, '-') << "\n";
+            }
+
+            long long tblNet = 0; // Net over every seat this round
+            int nSeat = 0; // Seats settled
+            // STL Algorithm: std::for_each to iterate over all players
+            std::for_each(plyrs.begin(), plyrs.end(), [&](Player& p) {
+                long long rndNet = 0; // Net result for this player's round
+                // Iterator: Iterate over all hands a player might have (original + split hands)
+                for (auto& hand : p.hands) { // For each hand
+                    if (hand.bet > 0) { // Only settle hands that were bet on
+                        int bet = hand.bet; // Bet before settlement clears it
+                        bool nat = is_nat(hand); // Natural before settlement clears it
+                        bool bust = calcScr(hand) > 21;
+                        int net = setHnd<Loud>(tbl, p, hand, dealrH, rul); // Settle the hand
+                        if (tly) { // Record the outcome
+                            tly->hands++;
+                            tly->busts += bust;
+                            tly->wagered += bet;
+                            if (net > 0) tly->wins++;
+                            else if (net < 0) tly->losses++;
+                            else tly->pushes++;
+                            if (nat && net > 0) tly->nats++;
+                        }
+                        rndNet += net;
+                    } else {
+                        discHnd(tbl, hand); // Clean up empty hands if any somehow remain
+                    }
+                }
+                if (tbl.rec) tbl.rec->net(rndNet);
+                if (tly) { // Per-round totals for EV and variance
+                    tly->rounds++;
+                    tly->net += rndNet;
+                    tly->seat[(p.id - 1) % MAXSEAT].add(static_cast<double>(rndNet));
+                }
+                tblNet += rndNet;
+                ++nSeat;
+                // Cleanup: Use std::remove_if to clean up all empty hands
+                p.hands.erase(std::remove_if(p.hands.begin(), p.hands.end(), [](const Hand& h){ // Lambda to check if hand is empty
+                    return h.cards.empty(); // Remove if empty
+                }), p.hands.end());
+            });
+
+            if (tly && nSeat > 0) tly->tblRnd.add(static_cast<double>(tblNet) / nSeat);
+
+            // Discard dealer's hand
+            discHnd(tbl, dealrH);
+            if (tbl.rec) tbl.rec->end();
+            profPh(tbl, PH_SETL);
+            if (PROF) {
+                tbl.prof.cur.rounds++;
+                tbl.prof.cur.allocs += allocCnt() - st.alloc0;
+            }
+            st.ph = RP_DONE;
+            return true;
+        }
+
+        case RP_DONE:
+            return true;
+        }
+    }
+}
+
+// Plays a single round of Blackjack for all players and the dealer.
+// Bets and actions come from the strategy, which must answer every
+// request at once; results are added to tly if given
+template <bool Loud, class R>
+void playRnd(Table& tbl, PlyrReg& plyrs, Player& dealr, Strat& strat, const R& rul, Tally* tly = nullptr) {
+    RndSt st; // A fresh round
+    if (!stepRnd<Loud>(tbl, plyrs, dealr, strat, rul, st, tly)) {
+        throw std::logic_error("Strategy left a bet or decision pending");
+    }
+}
+
+// Analysis Functions
+
+// Rank classes for composition-based analysis: Ace, 2-9, ten-valued
+const int NCLS = 10;
+
+// Class index of a card (0 = Ace, 1-8 = 2-9, 9 = 10/J/Q/K)
+inline int clsOf(const Card& c) {
+    return std::min(c.rank(), NCLS - 1);
+}
+
+// Hard value of a class (Ace = 1)
+inline int clsVal(int cls) {
+    return cls + 1;
+}
+
+// Bit offset of a class in a packed composition
+inline int packShft(int cls) {
+    return cls < NCLS - 1 ? 6 * cls : 54;
+}
+
+// Shoe Composition
+// Remaining cards counted by rank class; dealing probabilities depend only
+// on these counts, not on the order of the shoe
+struct Comp {
+    int cnt[NCLS] = {}; // Cards per class
+    int tot = 0; // Cards in total
+
+    void add(int cls, int n = 1) { cnt[cls] += n; tot += n; }
+    void take(int cls) { --cnt[cls]; --tot; }
+
+    // Packs the counts into 64 bits for cache keys: 6 bits for each of
+    // A-9 (at most 32 in an 8-deck shoe) and 8 bits for tens (at most 128)
+    uint64_t pack() const {
+        uint64_t key = 0;
+        for (int i = 0; i < NCLS; ++i) key |= static_cast<uint64_t>(cnt[i]) << packShft(i);
+        return key;
+    }
+};
+
+// Composition of the cards left to deal in a shoe
+Comp shoeComp(Shoe& deck) {
+    Comp comp;
+    for (const Card* c = deck.begin(); c != deck.end(); ++c) comp.add(clsOf(*c));
+    return comp;
+}
+
+// Composition of nDk full decks
+Comp fullComp(int nDk) {
+    Comp comp;
+    for (int i = 0; i < NCLS - 1; ++i) comp.add(i, 4 * nDk); // Four of each A-9
+    comp.add(NCLS - 1, 16 * nDk); // 10, J, Q, K
+    return comp;
+}
+
+// Dealer outcome slots in DlrDist::p
+const int DL17 = 0; // Final totals 17-21 occupy slots 0-4
+const int DLBUST = 5; // Dealer busts
+const int DLBJ = 6; // Dealer natural
+const int DLSLOTS = 7;
+
+// Dealer Final-Total Distribution
+struct DlrDist {
+    double p[DLSLOTS] = {}; // Probability of each outcome slot
+};
+
+// Dealer Probability Engine
+// Exact distribution of the dealer's final total given the upcard and
+// the remaining composition, drawing without replacement. Results are
+// memoized by (composition, upcard, peek) so repeated queries are a hash
+// lookup. Within one query, draw orders that reach the same multiset of
+// cards are merged, since total and softness depend only on the multiset.
+struct DlrEng {
+    bool h17; // Dealer hits soft 17
+
+    // Cache key: composition, upcard class and whether a dealer natural
+    // has already been ruled out (peek)
+    struct Key {
+        uint64_t comp;
+        uint32_t up;
+        bool operator==(const Key& oth) const { return comp == oth.comp && up == oth.up; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            uint64_t h = (k.comp ^ (static_cast<uint64_t>(k.up) << 59)) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<size_t>(h ^ (h >> 32));
+        }
+    };
+    std::unordered_map<Key, DlrDist, KeyHash> cache; // Memoized query results
+    size_t maxEnt = 1 << 20; // Cache entries kept before it is cleared
+    long long hits = 0; // Queries answered from the cache
+    long long misses = 0; // Queries computed
+
+    // Per-query subtree results keyed by the cards drawn, in an open-addressed
+    // table that a new query empties by bumping the stamp
+    static const size_t SUBSZ = 4096;
+    struct SubEnt {
+        uint64_t key = 0;
+        uint32_t stamp = 0; // Query that wrote the entry
+        DlrDist d;
+    };
+    std::vector<SubEnt> sub = std::vector<SubEnt>(SUBSZ);
+    uint32_t stamp = 0; // Current query
+
+    explicit DlrEng(bool hitS17 = false) : h17(hitS17) {}
+
+    // Distribution for upcard class upCls with comp the cards still unseen
+    // (upcard already removed). noBJ conditions on the dealer not holding a
+    // natural, as when the round continues past the natural check.
+    const DlrDist& dist(const Comp& comp, int upCls, bool noBJ) {
+        Key key{comp.pack(), static_cast<uint32_t>(upCls) | (noBJ ? 16u : 0u)};
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            ++hits;
+            return it->second;
+        }
+        ++misses;
+        if (cache.size() >= maxEnt) cache.clear(); // Bound memory on long runs
+
+        ++stamp; // Subtree results from the previous query do not apply
+        Comp work = comp; // Scratch composition for the walk
+        DlrDist res = walk(work, 0, clsVal(upCls), upCls == 0, 1, upCls, noBJ);
+
+        // Renormalize when the hole card was restricted by the peek
+        double sum = 0.0;
+        for (double p : res.p) sum += p;
+        if (sum > 0.0) for (double& p : res.p) p /= sum;
+        return cache.emplace(key, res).first->second;
+    }
+
+    // Distribution of outcomes from a dealer hand with the given hard total.
+    // dkey is the packed multiset of cards drawn so far (Comp::pack layout)
+    DlrDist walk(Comp& c, uint64_t dkey, int hard, bool ace, int nCrd, int upCls, bool noBJ) {
+        DlrDist res;
+        SubEnt* ent = subFind(dkey); // Every path to this multiset ends the same way
+        if (ent && ent->stamp == stamp) return ent->d;
+
+        // With a peek, the hole card cannot complete a natural
+        int skip = -1;
+        if (nCrd == 1 && noBJ) skip = upCls == 0 ? NCLS - 1 : (upCls == NCLS - 1 ? 0 : -1);
+        int n = c.tot - (skip >= 0 ? c.cnt[skip] : 0); // Cards the next draw can be
+
+        for (int cls = 0; cls < NCLS && n > 0; ++cls) {
+            if (c.cnt[cls] == 0 || cls == skip) continue;
+            double p = static_cast<double>(c.cnt[cls]) / n; // Chance of drawing this class
+            int nh = hard + clsVal(cls);
+            bool na = ace || cls == 0;
+            bool soft = na && nh <= 11; // One Ace counts as 11
+            int score = nh + (soft ? 10 : 0);
+            if (nCrd == 1 && score == 21) { // Natural
+                res.p[DLBJ] += p;
+            } else if (score > 21) { // Bust
+                res.p[DLBUST] += p;
+            } else if (score >= 17 && !(h17 && soft && score == 17)) { // Dealer stands
+                res.p[DL17 + score - 17] += p;
+            } else { // Dealer draws again
+                c.take(cls);
+                DlrDist sub = walk(c, dkey + (1ULL << packShft(cls)), nh, na, nCrd + 1, upCls, noBJ);
+                c.add(cls);
+                for (int i = 0; i < DLSLOTS; ++i) res.p[i] += p * sub.p[i];
+            }
+        }
+        // An exhausted composition leaves its probability mass unassigned
+        if (ent) {
+            ent->key = dkey;
+            ent->stamp = stamp;
+            ent->d = res;
+        }
+        return res;
+    }
+
+    // Slot for dkey in the subtree table: its current entry, an empty slot,
+    // or nullptr when the probe runs too long (the result is then not kept)
+    SubEnt* subFind(uint64_t dkey) {
+        size_t i = static_cast<size_t>((dkey * 0x9E3779B97F4A7C15ULL) >> 52) & (SUBSZ - 1);
+        for (int probe = 0; probe < 16; ++probe, i = (i + 1) & (SUBSZ - 1)) {
+            SubEnt& e = sub[i];
+            if (e.stamp != stamp || e.key == dkey) return &e;
+        }
+        return nullptr;
+    }
+};
+
+// Action Values
+// Expected value of each action in units of the hand's initial bet;
+// NAN marks an action that is not available
+struct ActEv {
+    double stand = NAN;
+    double hit = NAN;
+    double dbl = NAN;
+    double splt = NAN;
+    double surr = NAN;
+};
+
+// Expected Value Engine
+// Composition-dependent EV of standing, hitting, doubling and splitting
+// for the current hand. Player draws always come from the exact unseen
+// composition. Stands are scored against the dealer's distribution (from
+// DlrEng, given no dealer natural when the dealer peeks, as play only
+// reaches hdlPlay then; with no hole card a dealer natural takes every
+// bet including doubles and splits) for the composition after the current hand and the first card drawn to it;
+// later hit cards are not removed from the dealer's shoe again, which
+// changes the result by far less than a hundredth of a percent and keeps
+// a decision to a few dozen dealer distributions.
+// Best-play values are memoized by (composition, dealer composition,
+// hand state, upcard). Hitting is pruned when standing already reaches
+// the best result a hit could produce, 1 - 2 * P(bust on the next card).
+// A split plays both hands from the composition left after the split,
+// ignoring how cards drawn to one hand change the other and any resplits.
+// Split Aces receive one card each and must stand.
+struct EvEng {
+    DlrEng dlr; // Dealer distributions, memoized across queries
+    bool peek; // Dealer checks for a natural before the players act
+    bool das; // Double after split
+    int upCls = 0; // Dealer upcard class for the current query
+
+    // Memo entry: player and dealer compositions plus hand state and upcard.
+    // The memo is direct-mapped, so a colliding state simply replaces the
+    // older one and memory stays fixed however long the run
+    struct MemEnt {
+        uint64_t comp = 0;
+        uint64_t dlrC = 0;
+        uint32_t state = 0; // 0 marks an empty slot (a hand is never 0)
+        double val = 0.0;
+    };
+    static const size_t MEMSZ = 1 << 16;
+    std::vector<MemEnt> memo = std::vector<MemEnt>(MEMSZ); // Best value after hitting
+
+    explicit EvEng(bool h17 = false, bool pk = true, bool dblSplt = true) : dlr(h17), peek(pk), das(dblSplt) {}
+
+    // EV of every available action for a hand with the given hard total and
+    // Ace flag. unseen is every card the player has not seen (the rest of
+    // the shoe plus the dealer's hole card). pairCls is the class of a
+    // splittable pair, or -1.
+    ActEv eval(const Comp& unseen, int hard, bool ace, int up, int pairCls, bool canDbl, bool canSurr = false) {
+        upCls = up;
+        Comp c = unseen; // Scratch composition
+        ActEv res;
+        res.stand = standEv(unseen, hard, ace);
+        if (score(hard, ace) < 21) res.hit = hitEv(c, unseen, true, hard, ace, NAN); // Exact, unpruned
+        if (canDbl) res.dbl = 2.0 * dblEv(c, hard, ace);
+        if (pairCls >= 0) res.splt = 2.0 * spltEv(c, pairCls, canDbl && das);
+        if (canSurr) res.surr = -0.5; // Half the bet back
+        return res;
+    }
+
+    static int score(int hard, bool ace) {
+        return hard + ((ace && hard <= 11) ? 10 : 0);
+    }
+
+    // EV of standing against the dealer drawing from dc
+    double standEv(const Comp& dc, int hard, bool ace) {
+        int sc = score(hard, ace);
+        if (sc > 21) return -1.0; // Busted hands lose before the dealer plays
+        const DlrDist& d = dlr.dist(dc, upCls, peek);
+        double ev = d.p[DLBUST] - d.p[DLBJ]; // Dealer busts: player wins; a natural (no peek) beats the hand
+        for (int t = 17; t <= 21; ++t) {
+            double p = d.p[DL17 + t - 17];
+            if (sc > t) ev += p;
+            else if (sc < t) ev -= p;
+        }
+        return ev;
+    }
+
+    // EV of taking one card from c and then playing on optimally. dc is the
+    // dealer's composition, replaced by c after the draw when frst is set.
+    // standNow prunes: the hit cannot beat 1 - 2 * P(bust on next card)
+    double hitEv(Comp& c, const Comp& dc, bool frst, int hard, bool ace, double standNow) {
+        if (c.tot == 0) return NAN;
+        int bust = 0; // Cards that would bust the hand
+        for (int cls = 0; cls < NCLS; ++cls) {
+            if (hard + clsVal(cls) > 21) bust += c.cnt[cls];
+        }
+        double best = 1.0 - 2.0 * bust / c.tot; // Upper bound on hitting
+        if (!std::isnan(standNow) && standNow >= best) return best; // Cannot beat standing
+
+        double ev = 0.0;
+        for (int cls = 0; cls < NCLS; ++cls) {
+            if (c.cnt[cls] == 0) continue;
+            double p = static_cast<double>(c.cnt[cls]) / c.tot;
+            int nh = hard + clsVal(cls); // Hard total after the draw
+            if (nh > 21) { // Bust
+                ev -= p;
+                continue;
+            }
+            c.take(cls);
+            if (frst) {
+                Comp fz = c; // The dealer draws from what is left after this card
+                ev += p * bestAfterHit(c, fz, nh, ace || cls == 0);
+            } else {
+                ev += p * bestAfterHit(c, dc, nh, ace || cls == 0);
+            }
+            c.add(cls);
+        }
+        return ev;
+    }
+
+    // Best of standing and hitting again, memoized
+    double bestAfterHit(Comp& c, const Comp& dc, int hard, bool ace) {
+        uint64_t comp = c.pack();
+        uint64_t dlrC = dc.pack();
+        uint32_t state = static_cast<uint32_t>(hard) | (ace ? 32u : 0u) | (static_cast<uint32_t>(upCls) << 6);
+        uint64_t h = (comp ^ (dlrC * 0xC2B2AE3D27D4EB4FULL) ^ state) * 0x9E3779B97F4A7C15ULL;
+        MemEnt& ent = memo[(h >> 32) & (MEMSZ - 1)];
+        if (ent.state == state && ent.comp == comp && ent.dlrC == dlrC) return ent.val;
+        double st = standEv(dc, hard, ace);
+        double val = st;
+        if (score(hard, ace) < 21) { // The game stands automatically on 21
+            double ht = hitEv(c, dc, false, hard, ace, st);
+            if (ht > val) val = ht;
+        }
+        ent.comp = comp; // Recursion may have used the slot; claim it now
+        ent.dlrC = dlrC;
+        ent.state = state;
+        ent.val = val;
+        return val;
+    }
+
+    // EV per bet of doubling: exactly one more card, then stand
+    double dblEv(Comp& c, int hard, bool ace) {
+        double ev = 0.0;
+        for (int cls = 0; cls < NCLS; ++cls) {
+            if (c.cnt[cls] == 0) continue;
+            double p = static_cast<double>(c.cnt[cls]) / c.tot;
+            c.take(cls);
+            ev += p * standEv(c, hard + clsVal(cls), ace || cls == 0);
+            c.add(cls);
+        }
+        return ev;
+    }
+
+    // EV per bet of one split hand that starts from a single pairCls card
+    double spltEv(Comp& c, int pairCls, bool canDbl) {
+        double ev = 0.0;
+        for (int cls = 0; cls < NCLS; ++cls) {
+            if (c.cnt[cls] == 0) continue;
+            double p = static_cast<double>(c.cnt[cls]) / c.tot;
+            int hard = clsVal(pairCls) + clsVal(cls);
+            bool ace = pairCls == 0 || cls == 0;
+            c.take(cls);
+            Comp fz = c; // Dealer composition after the split hand's second card
+            double val = standEv(fz, hard, ace);
+            if (pairCls != 0 && score(hard, ace) < 21) { // Split Aces must stand
+                double ht = hitEv(c, fz, false, hard, ace, val);
+                if (ht > val) val = ht;
+                if (canDbl) val = std::max(val, 2.0 * dblEv(c, hard, ace));
+            }
+            ev += p * val;
+            c.add(cls);
+        }
+        return ev;
+    }
+};
+
+// Prints the dealer distribution for every upcard from a fresh shoe
+void prntDlr(int nDk, bool h17) {
+    DlrEng eng(h17); // Analytic engine
+    const char* UPSTR[NCLS] = {"A", "2", "3", "4", "5", "6", "7", "8", "9", "10"};
+
+    std::cout << "### Dealer Outcome Probabilities (" << nDk << " decks, dealer "
+              << (h17 ? "hits" : "stands on") << " soft 17) ###\n";
+    std::cout << std::left << std::setw(6) << "Up" << std::right;
+    const char* HDR[DLSLOTS] = {"17", "18", "19", "20", "21", "Bust", "BJ"};
+    for (const char* h : HDR) std::cout << std::setw(9) << h;
+    std::cout << "\n" << std::setprecision(4);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int up = 0; up < NCLS; ++up) {
+        Comp comp = fullComp(nDk);
+        comp.take(up); // The upcard is no longer in the shoe
+        const DlrDist& d = eng.dist(comp, up, false);
+        std::cout << std::left << std::setw(6) << UPSTR[up] << std::right;
+        for (double p : d.p) std::cout << std::setw(9) << p;
+        std::cout << "\n";
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    // Repeat the queries to show the cache at work
+    auto again = std::chrono::steady_clock::now();
+    for (int up = 0; up < NCLS; ++up) {
+        Comp comp = fullComp(nDk);
+        comp.take(up);
+        eng.dist(comp, up, false);
+    }
+    double usHit = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - again).count();
+    std::cout << std::setprecision(1) << "Computed in " << us << " us; cached repeat in " << usHit << " us ("
+              << eng.hits << " hits, " << eng.misses << " misses)\n" << std::setprecision(0);
+}
+
+// Console Strategy
+// Reads bets and actions from std::cin for interactive play
+struct ConStrat : Strat {
+    int getBet(const Player& p) override {
+        int betAmt = 0; // Bet amount input
+
+        // Prompt for bet until valid
+        while (betAmt < 1 || betAmt > p.chips) { // Invalid bet
+            std::cout << p.name << " (Chips: $" << p.chips << "), place your bet: ";
+            std::cin >> betAmt; // Input bet amount
+            clear_in();
+            if (betAmt < 1 || betAmt > p.chips) { // Invalid bet
+                std::cout << "Invalid bet. Must be between $1 and $" << p.chips << ".\n";
+            }
+        }
+        return betAmt;
+    }
+
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        std::string choice; // Player choice input
+
+        // Prompt for action
+        std::cout << "Actions: (H)it / (S)tand";
+
+        // Display available actions
+        if (canSplt) std::cout << " / (P)lit"; // 'P' for sPlit to avoid confusion with 'S'tand
+        if (canDbl) std::cout << " / (D)ouble Down"; // 'D' for Double Down
+        if (canSurr) std::cout << " / Su(R)render"; // 'R' for suRrender to avoid confusion with 'S'tand
+        std::cout << "\nChoose action: ";
+
+        std::cout << " > ";
+
+        // Player chooses action
+        std::cin >> choice;
+
+        // Standardize input to uppercase
+        std::transform(choice.begin(), choice.end(), choice.begin(), ::toupper);
+        clear_in();
+
+        // Only single-letter choices are valid actions
+        return choice.size() == 1 ? choice[0] : '?';
+    }
+};
+
+// Flat bet used by the automated strategies
+const int SIMUNIT = 10;
+// Bankroll each simulated seat starts every round with
+const int SIMBANK = 1000000;
+// Rounds per table between precision checks with --precision
+const long long STATCHNK = 250000;
+
+// Mimic-the-Dealer Strategy
+// Flat bets one unit and hits below 17, never splits or doubles
+struct MimStrat : Strat {
+    int unit; // Flat bet size
+    explicit MimStrat(int u = SIMUNIT) : unit(u) {}
+
+    int getBet(const Player& p) override {
+        return std::min(unit, p.chips); // Flat bet, capped by chips
+    }
+
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        return calcScr(hand) < 17 ? 'H' : 'S'; // Same rule as the dealer
+    }
+};
+
+// Basic Strategy Tables
+// Action codes: 'H' hit, 'S' stand, 'D' double (else hit),
+// 'd' double (else stand), 'P' split; 0 in pair[] means play the total.
+// Upcard column: 2-10 -> 0-8, Ace -> 9. Pair row: hard value - 1 (Ace = 0).
+struct BasTbl {
+    char hard[22][10]; // Hard total x upcard
+    char soft[22][10]; // Soft total x upcard
+    char pair[10][10]; // Pair rank x upcard
+    char surr[22][10]; // Hard total x upcard: 'R' to late-surrender
+};
+
+// Builds the multi-deck basic strategy for a dealer that hits (h17) or
+// stands on soft 17, with or without double after split (das)
+constexpr BasTbl mkBasTbl(bool h17, bool das) {
+    BasTbl t{};
+    for (int u = 0; u < 10; ++u) {
+        int up = u + 2; // Upcard value, Ace = 11
+
+        for (int tot = 0; tot < 22; ++tot) {
+            // Hard totals
+            char h = 'H';
+            if (tot >= 17) h = 'S';
+            else if (tot >= 13) h = up <= 6 ? 'S' : 'H';
+            else if (tot == 12) h = (up >= 4 && up <= 6) ? 'S' : 'H';
+            else if (tot == 11) h = (up <= 10 || h17) ? 'D' : 'H';
+            else if (tot == 10) h = up <= 9 ? 'D' : 'H';
+            else if (tot == 9) h = (up >= 3 && up <= 6) ? 'D' : 'H';
+            t.hard[tot][u] = h;
+
+            // Soft totals
+            char sf = 'H';
+            if (tot >= 20) sf = 'S';
+            else if (tot == 19) sf = (h17 && up == 6) ? 'd' : 'S';
+            else if (tot == 18) sf = ((up >= 3 && up <= 6) || (h17 && up == 2)) ? 'd' : (up <= 8 ? 'S' : 'H');
+            else if (tot == 17) sf = (up >= 3 && up <= 6) ? 'D' : 'H';
+            else if (tot >= 15) sf = (up >= 4 && up <= 6) ? 'D' : 'H';
+            else if (tot >= 13) sf = (up >= 5 && up <= 6) ? 'D' : 'H';
+            t.soft[tot][u] = sf;
+
+            // Late surrender: 16 vs 9-Ace, 15 vs 10, and vs Ace also 15 and 17 under H17
+            bool sr = (tot == 16 && up >= 9) || (tot == 15 && up == 10) || (h17 && up == 11 && (tot == 15 || tot == 17));
+            t.surr[tot][u] = sr ? 'R' : 0;
+        }
+
+        for (int pr = 0; pr < 10; ++pr) {
+            int v = pr + 1; // Pair card hard value, Ace = 1
+            bool sp = false; // Split this pair?
+            switch (v) {
+                case 1: case 8: sp = true; break; // Always split Aces and 8s
+                case 9: sp = up <= 9 && up != 7; break; // Not vs 7, 10, Ace
+                case 7: sp = up <= 7; break;
+                case 6: sp = das ? up <= 6 : (up >= 3 && up <= 6); break;
+                case 4: sp = das && (up == 5 || up == 6); break;
+                case 2: case 3: sp = das ? up <= 7 : (up >= 4 && up <= 7); break;
+                default: sp = false; break; // Never split 5s or 10s
+            }
+            t.pair[pr][u] = sp ? 'P' : 0;
+        }
+    }
+    return t;
+}
+
+// All four variants, built at compile time: [h17][das]
+constexpr BasTbl BASTBL[2][2] = {
+    {mkBasTbl(false, false), mkBasTbl(false, true)},
+    {mkBasTbl(true, false), mkBasTbl(true, true)}
+};
+
+// Upcard column for BasTbl lookups
+inline int upIdx(const Card& c) {
+    return c.isAce() ? 9 : c.hard() - 2;
+}
+
+// Basic strategy decision from a table (shared by BasStrat and the batch
+// simulator). pr is the pair row when the hand may split, else -1
+inline char basAct(const BasTbl& tbl, int score, bool soft, int pr, int u, bool canDbl, bool canSurr) {
+    if (pr >= 0 && tbl.pair[pr][u] == 'P') return 'P';
+    if (canSurr && !soft && tbl.surr[score][u] == 'R') return 'R';
+    char act = soft ? tbl.soft[score][u] : tbl.hard[score][u];
+    if (act == 'D') return canDbl ? 'D' : 'H'; // Double, else hit
+    if (act == 'd') return canDbl ? 'D' : 'S'; // Double, else stand
+    return act;
+}
+
+// Basic Strategy
+// Flat bets one unit and plays every decision from a precomputed table
+struct BasStrat : Strat {
+    int unit; // Flat bet size
+    const BasTbl& tbl; // Table for the table's rules
+
+    explicit BasStrat(bool h17 = false, bool das = true, int u = SIMUNIT) : unit(u), tbl(BASTBL[h17][das]) {}
+
+    int getBet(const Player& p) override {
+        return std::min(unit, p.chips); // Flat bet, capped by chips
+    }
+
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        int pr = canSplt ? hand.cards.front().hard() - 1 : -1; // Pair row
+        return basAct(tbl, calcScr(hand), isSoft(hand), pr, upIdx(upCrd), canDbl, canSurr);
+    }
+};
+
+// Perfect-Play Strategy
+// Flat bets one unit and takes the highest-EV action for the exact set of
+// cards the player has not seen, as computed by EvEng
+struct EvStrat : Strat {
+    int unit; // Flat bet size
+    Table& tbl; // Table whose shoe is analysed
+    const Hand& dlHnd; // Dealer's hand, for the unseen hole card
+    EvEng eng; // EV engine with its caches
+
+    EvStrat(Table& t, const Hand& dh, const RuleSet& rul, int u = SIMUNIT)
+        : unit(u), tbl(t), dlHnd(dh), eng(rul.h17, !rul.enhc, rul.das) {}
+
+    int getBet(const Player& p) override {
+        return std::min(unit, p.chips); // Flat bet, capped by chips
+    }
+
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        Comp unseen = shoeComp(tbl.deck); // Cards left in the shoe
+        if (dlHnd.cards.size() > 1) unseen.add(clsOf(dlHnd.cards[1])); // Plus the hole card
+        int pairCls = canSplt ? clsOf(hand.cards.front()) : -1;
+        ActEv ev = eng.eval(unseen, hand.hard, hand.aces > 0, clsOf(upCrd), pairCls, canDbl, canSurr);
+
+        // Highest value wins; NAN never compares greater
+        char act = 'S';
+        double best = ev.stand;
+        if (ev.hit > best) { act = 'H'; best = ev.hit; }
+        if (ev.dbl > best) { act = 'D'; best = ev.dbl; }
+        if (ev.splt > best) { act = 'P'; best = ev.splt; }
+        if (ev.surr > best) { act = 'R'; best = ev.surr; }
+        return act;
+    }
+};
+
+// Counting Strategy
+// Plays basic strategy and spreads the bet with the count: one unit at a
+// true count of +1 or less, then one more unit per point up to spread units
+struct CntStrat : BasStrat {
+    const Table& tbl; // Table whose count sizes the bet
+    int spread; // Largest bet in units
+
+    CntStrat(const Table& t, const RuleSet& rul, int sprd = 8) : BasStrat(rul.h17, rul.das), tbl(t), spread(sprd) {}
+
+    int getBet(const Player& p) override {
+        int units = static_cast<int>(std::floor(trueCnt(tbl))); // Count at the bet
+        units = std::max(1, std::min(spread, units));
+        return std::min(unit * units, p.chips); // Capped by chips
+    }
+};
+
+// Automated strategies selectable for simulation
+enum class StratKind { BASIC, MIMIC, EV, COUNT };
+
+// Creates a fresh strategy of the given kind for one table and its rules
+std::unique_ptr<Strat> mkStrat(StratKind kind, Table& tbl, const Player& dealr, const RuleSet& rul) {
+    if (kind == StratKind::MIMIC) return std::unique_ptr<Strat>(new MimStrat());
+    if (kind == StratKind::EV) return std::unique_ptr<Strat>(new EvStrat(tbl, dealr.hands.front(), rul));
+    if (kind == StratKind::COUNT) return std::unique_ptr<Strat>(new CntStrat(tbl, rul));
+    return std::unique_ptr<Strat>(new BasStrat(rul.h17, rul.das));
+}
+
+// Batch Simulation
+// Plays many independent tables in lockstep, one phase at a time (bet,
+// deal, act, dealer, settle). State is kept as structure-of-arrays: one
+// entry per table for the dealer and one per hand slot for the seats, so
+// every phase is a flat loop over tables or slots with no maps, queue
+// copies or per-player callbacks. Seats play basic strategy with a flat
+// bet and an unlimited bankroll, as in simTbl; the event log and card
+// count are not kept in batch mode.
+
+// Hand flags in TblBat::hFlg
+const uint8_t HF_SPLT = 1; // Made by a split
+const uint8_t HF_DBL = 2; // Doubled
+const uint8_t HF_SURR = 4; // Surrendered
+const uint8_t HF_NAT = 8; // Natural (two-card 21, not split)
+const uint8_t HF_DONE = 16; // No more decisions
+
+// Settlement inputs, one entry per slot
+struct SetlArgs {
+    const uint8_t* hard; // Player hard total
+    const uint8_t* aces; // Player Aces held
+    const uint8_t* flg; // HF_* flags
+    const uint8_t* dScr; // Dealer final score
+    const uint8_t* dNat; // Dealer natural (0/1)
+    const int32_t* bet; // Bet
+    int bjNum; // Natural pays bjNum:bjDen
+    int bjDen;
+};
+
+using SetlFn = void (*)(const SetlArgs& a, int32_t* net, int i0, int n);
+
+// Kernel instruction sets, slowest first
+enum class SimdLvl { SCALAR, SSE41, AVX2 };
+const char* const SIMDNM[] = {"scalar", "sse4.1", "avx2"};
+
+// Table Batch
+// Slot index: seat = t * nSeat + s, slot = seat * MAXHNDS + k
+struct TblBat {
+    int nTbl = 0; // Tables in the batch
+    int nSeat = 0; // Seats per table
+    std::vector<Shoe> shoes; // One shoe per table
+    std::vector<Rng> rngs; // One random stream per table
+    std::vector<int> rndBeg; // Shoe cursor when the round began; cards before it are discards
+
+    // Dealer, per table
+    std::vector<uint8_t> dUp; // Upcard code
+    std::vector<uint8_t> dHard; // Hard total
+    std::vector<uint8_t> dAces; // Aces held
+    std::vector<uint8_t> dNCrd; // Cards held
+    std::vector<uint8_t> dNat; // Dealer natural
+
+    // Seats, per (table, seat)
+    std::vector<uint8_t> sHnds; // Hands in use (more after splits)
+
+    // Hands, per slot
+    std::vector<uint8_t> hHard; // Hard total
+    std::vector<uint8_t> hAces; // Aces held
+    std::vector<uint8_t> hNCrd; // Cards held
+    std::vector<uint8_t> hR1; // Rank of the first card (the pair card after a split)
+    std::vector<uint8_t> hR2; // Rank of the second card
+    std::vector<uint8_t> hFlg; // HF_* flags
+    std::vector<uint8_t> hDScr; // Dealer's final score for the slot's table
+    std::vector<uint8_t> hDNat; // Dealer natural for the slot's table
+    std::vector<int32_t> hBet; // Bet (0 for an unused slot)
+    std::vector<int32_t> hNet; // Net chips after settlement
+    SetlFn setl = nullptr; // Settlement kernel
+
+    TblBat(int tbls, int seats) : nTbl(tbls), nSeat(seats), shoes(tbls), rngs(tbls), rndBeg(tbls),
+        dUp(tbls), dHard(tbls), dAces(tbls), dNCrd(tbls), dNat(tbls),
+        sHnds(tbls * seats) {
+        size_t n = static_cast<size_t>(tbls) * seats * MAXHNDS; // Hand slots
+        for (auto* v : {&hHard, &hAces, &hNCrd, &hR1, &hR2, &hFlg, &hDScr, &hDNat}) v->assign(n, 0);
+        hBet.assign(n, 0);
+        hNet.assign(n, 0);
+    }
+};
+
+// Best score from a hard total and Ace count, without branches
+inline int batScr(int hard, int aces) {
+    return hard + 10 * ((aces > 0) & (hard <= 11));
+}
+
+// Next card for table t. An empty shoe mid-round rotates the cards still
+// in play to the front and reshuffles the discards behind them.
+inline Card batDraw(TblBat& b, int t) {
+    Shoe& sh = b.shoes[t];
+    if (sh.empty()) {
+        int beg = b.rndBeg[t]; // Cards before beg are discards
+        std::rotate(sh.cards, sh.cards + beg, sh.cards + sh.len);
+        sh.pos = sh.len - beg; // In-play cards now sit at the front
+        b.rndBeg[t] = 0;
+        if (sh.empty()) throw std::runtime_error("No cards left to deal or shuffle!");
+        shufFY(sh.begin(), sh.size(), b.rngs[t]);
+    }
+    return sh.deal();
+}
+
+// Adds a card to hand slot i
+inline void batAdd(TblBat& b, int i, Card c) {
+    b.hHard[i] += c.hard();
+    b.hAces[i] += c.isAce();
+    if (b.hNCrd[i] == 0) b.hR1[i] = c.rank();
+    else if (b.hNCrd[i] == 1) b.hR2[i] = c.rank();
+    b.hNCrd[i]++;
+}
+
+// Bet phase for tables [0, nAct): reshuffle at the cut card, clear the
+// hands and place one flat bet per seat
+template <class R>
+void batBet(TblBat& b, int nAct, int unit, const R& rul) {
+    for (int t = 0; t < nAct; ++t) {
+        Shoe& sh = b.shoes[t];
+        if (sh.size() < rul.cut) { // Every card is back: shuffle the whole shoe
+            sh.pos = 0;
+            shufFY(sh.begin(), sh.size(), b.rngs[t]);
+        }
+        b.rndBeg[t] = sh.pos;
+    }
+    for (auto* v : {&b.dHard, &b.dAces, &b.dNCrd, &b.dNat}) std::memset(v->data(), 0, nAct);
+    int nSeats = nAct * b.nSeat;
+    std::memset(b.sHnds.data(), 1, nSeats);
+    int nSlot = nSeats * MAXHNDS;
+    for (auto* v : {&b.hHard, &b.hAces, &b.hNCrd, &b.hFlg}) std::memset(v->data(), 0, nSlot);
+    std::memset(b.hBet.data(), 0, nSlot * sizeof(int32_t));
+    for (int i = 0; i < nSlot; i += MAXHNDS) b.hBet[i] = unit; // First hand of each seat
+}
+
+// Deal phase: two cards to each seat and the dealer, round by round
+template <class R>
+void batDeal(TblBat& b, int nAct, const R& rul) {
+    for (int rnd = 0; rnd < 2; ++rnd) {
+        for (int t = 0; t < nAct; ++t) {
+            for (int s = 0; s < b.nSeat; ++s) batAdd(b, (t * b.nSeat + s) * MAXHNDS, batDraw(b, t));
+            if (rnd == 1 && rul.enhc) continue; // No hole card
+            Card c = batDraw(b, t);
+            if (rnd == 0) b.dUp[t] = c.code;
+            b.dHard[t] += c.hard();
+            b.dAces[t] += c.isAce();
+            b.dNCrd[t]++;
+        }
+    }
+    for (int t = 0; t < nAct; ++t) { // Naturals
+        b.dNat[t] = b.dNCrd[t] == 2 && batScr(b.dHard[t], b.dAces[t]) == 21;
+    }
+    int nSlot = nAct * b.nSeat * MAXHNDS;
+    for (int i = 0; i < nSlot; i += MAXHNDS) {
+        if (batScr(b.hHard[i], b.hAces[i]) == 21) b.hFlg[i] |= HF_NAT | HF_DONE;
+    }
+}
+
+// Act phase: plays out each table in turn, its seats in order and each
+// seat's hands in order, as hdlPlay does, so cards come off each shoe in
+// the same order. Decisions are branchy whatever the layout, so there is
+// nothing to gain from interleaving tables here; one table at a time keeps
+// its slots in cache and skips no finished tables. Tables whose dealer
+// has a natural skip straight to settlement.
+template <class R>
+void batAct(TblBat& b, int nAct, const BasTbl& tbl, const R& rul) {
+    for (int t = 0; t < nAct; ++t) {
+        if (b.dNat[t]) continue; // Nothing to play after a natural
+        int up = upIdx(Card(b.dUp[t] >> 2, b.dUp[t] & 3));
+        for (int s = t * b.nSeat; s < (t + 1) * b.nSeat; ++s) {
+            for (int k = 0; k < b.sHnds[s]; ++k) { // A split adds a hand to this loop
+                int i = s * MAXHNDS + k; // Slot being played
+                uint8_t& flg = b.hFlg[i];
+                for (;;) {
+                    int score = batScr(b.hHard[i], b.hAces[i]);
+                    bool splAce = (flg & HF_SPLT) && b.hR1[i] == 0; // Split Aces take one card
+                    if ((flg & HF_DONE) || score >= 21 || splAce) break;
+
+                    bool two = b.hNCrd[i] == 2;
+                    bool canSplt = two && b.hR1[i] == b.hR2[i] && b.sHnds[s] < rul.spltHnds;
+                    bool canDbl = two && (rul.das || !(flg & HF_SPLT));
+                    bool canSurr = rul.surr && two && !(flg & HF_SPLT);
+                    bool soft = (b.hAces[i] > 0) & (b.hHard[i] <= 11);
+                    int pr = canSplt ? RNKHRD[b.hR1[i]] - 1 : -1;
+                    char act = basAct(tbl, score, soft, pr, up, canDbl, canSurr);
+
+                    if (act == 'H') {
+                        batAdd(b, i, batDraw(b, t));
+                    } else if (act == 'D') {
+                        b.hBet[i] *= 2;
+                        batAdd(b, i, batDraw(b, t));
+                        flg |= HF_DBL | HF_DONE;
+                    } else if (act == 'R') {
+                        flg |= HF_SURR | HF_DONE;
+                    } else if (act == 'P') {
+                        int j = s * MAXHNDS + b.sHnds[s]++; // New hand in the next free slot
+                        int v = RNKHRD[b.hR1[i]]; // Pair card value
+                        bool ace = b.hR1[i] == 0;
+                        b.hHard[j] = b.hHard[i] = v;
+                        b.hAces[j] = b.hAces[i] = ace;
+                        b.hNCrd[j] = b.hNCrd[i] = 1;
+                        b.hR1[j] = b.hR1[i];
+                        b.hFlg[j] = flg = HF_SPLT;
+                        b.hBet[j] = b.hBet[i];
+                        b.hNet[j] = 0;
+                        batAdd(b, i, batDraw(b, t));
+                        batAdd(b, j, batDraw(b, t));
+                    } else { // Stand
+                        flg |= HF_DONE;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Dealer phase: the deferred second card under no hole card, then each
+// dealer draws until it stands
+template <class R>
+void batDlr(TblBat& b, int nAct, const R& rul) {
+    for (int t = 0; t < nAct; ++t) {
+        if (rul.enhc) {
+            Card c = batDraw(b, t);
+            b.dHard[t] += c.hard();
+            b.dAces[t] += c.isAce();
+            b.dNCrd[t]++;
+            b.dNat[t] = batScr(b.dHard[t], b.dAces[t]) == 21;
+        }
+        if (b.dNat[t]) continue;
+        for (;;) {
+            int hard = b.dHard[t];
+            int d = batScr(hard, b.dAces[t]);
+            bool soft17 = d == 17 && b.dAces[t] > 0 && hard <= 11;
+            if (d >= 17 && !(rul.h17 && soft17)) break; // Stands
+            Card c = batDraw(b, t);
+            b.dHard[t] += c.hard();
+            b.dAces[t] += c.isAce();
+        }
+    }
+}
+
+// Settlement Kernels
+// Score and settle hand slots [i0, n) of the batch arrays, writing each
+// slot's chip delta to net. One branch-free rule in three builds: scalar,
+// SSE4.1 (16 hands per byte vector) and AVX2 (32 hands). Outcomes are
+// worked out as byte masks across all lanes, then widened to 32-bit lanes
+// to select the delta for each bet. Natural pays are exact through
+// double, so any bet that fits an int32 settles as in setHnd.
+
+// Scalar kernel; also finishes the tail the vector kernels leave
+void setlScl(const SetlArgs& a, int32_t* net, int i0, int n) {
+    for (int i = i0; i < n; ++i) {
+        int bet = a.bet[i];
+        int ps = batScr(a.hard[i], a.aces[i]);
+        int ds = a.dScr[i];
+        bool pNat = a.flg[i] & HF_NAT;
+        bool dNat = a.dNat[i];
+        int win = ps > 21 ? -bet // Bust
+                : pNat ? (dNat ? 0 : static_cast<int>(static_cast<long long>(bet) * a.bjNum / a.bjDen)) // Natural
+                : dNat ? -bet // Dealer natural
+                : ds > 21 || ps > ds ? bet : ps < ds ? -bet : 0; // Dealer bust or compare
+        net[i] = (a.flg[i] & HF_SURR) ? bet / 2 - bet : win;
+    }
+}
+
+#ifdef BJSIMD
+// 4 natural pays, floor(bet * num / den), through double
+__attribute__((target("sse4.1")))
+static inline __m128i natSse(__m128i bet, __m128d num, __m128d den) {
+    __m128d lo = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(bet), num), den);
+    __m128d hi = _mm_div_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(bet, 8)), num), den);
+    return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// Deltas for 4 slots whose masks sit in the low 4 bytes of w, l, nt, s
+__attribute__((target("sse4.1")))
+static inline void setl4Sse(__m128i w, __m128i l, __m128i nt, __m128i s, const int32_t* bet, int32_t* out,
+                            __m128d num, __m128d den) {
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bet));
+    __m128i d = _mm_and_si128(_mm_cvtepi8_epi32(w), b); // Win: +bet
+    d = _mm_or_si128(d, _mm_and_si128(_mm_cvtepi8_epi32(l), _mm_sub_epi32(_mm_setzero_si128(), b))); // Lose: -bet
+    d = _mm_or_si128(d, _mm_and_si128(_mm_cvtepi8_epi32(nt), natSse(b, num, den))); // Natural
+    d = _mm_or_si128(d, _mm_and_si128(_mm_cvtepi8_epi32(s), _mm_sub_epi32(_mm_srai_epi32(b, 1), b))); // Surrender
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), d);
+}
+
+// SSE4.1 kernel: 16 slots per pass
+__attribute__((target("sse4.1")))
+void setlSse(const SetlArgs& a, int32_t* net, int i0, int n) {
+    const __m128i k10 = _mm_set1_epi8(10), k11 = _mm_set1_epi8(11), k21 = _mm_set1_epi8(21);
+    const __m128i kNat = _mm_set1_epi8(HF_NAT), kSurr = _mm_set1_epi8(HF_SURR);
+    const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi8(-1);
+    const __m128d num = _mm_set1_pd(a.bjNum), den = _mm_set1_pd(a.bjDen);
+    int i = i0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i hard = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.hard + i));
+        __m128i aces = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.aces + i));
+        __m128i flg = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.flg + i));
+        __m128i ds = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.dScr + i));
+        __m128i dn = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.dNat + i));
+        __m128i soft = _mm_andnot_si128(_mm_cmpgt_epi8(hard, k11), _mm_cmpgt_epi8(aces, zero));
+        __m128i ps = _mm_add_epi8(hard, _mm_and_si128(soft, k10)); // Player score
+        __m128i bust = _mm_cmpgt_epi8(ps, k21);
+        __m128i pNat = _mm_cmpeq_epi8(_mm_and_si128(flg, kNat), kNat);
+        __m128i surr = _mm_cmpeq_epi8(_mm_and_si128(flg, kSurr), kSurr);
+        __m128i dNat = _mm_cmpgt_epi8(dn, zero);
+        __m128i dBust = _mm_cmpgt_epi8(ds, k21);
+        __m128i rest = _mm_andnot_si128(_mm_or_si128(bust, pNat), ones); // Neither bust nor natural
+        __m128i live = _mm_andnot_si128(dNat, rest); // Comes down to the dealer's total
+        __m128i win = _mm_and_si128(live, _mm_or_si128(dBust, _mm_cmpgt_epi8(ps, ds)));
+        __m128i lose = _mm_or_si128(bust, _mm_and_si128(rest, dNat));
+        lose = _mm_or_si128(lose, _mm_andnot_si128(dBust, _mm_and_si128(live, _mm_cmpgt_epi8(ds, ps))));
+        __m128i nat = _mm_andnot_si128(dNat, pNat);
+        win = _mm_andnot_si128(surr, win); // Surrender overrides the rest
+        lose = _mm_andnot_si128(surr, lose);
+        nat = _mm_andnot_si128(surr, nat);
+        setl4Sse(win, lose, nat, surr, a.bet + i, net + i, num, den);
+        setl4Sse(_mm_srli_si128(win, 4), _mm_srli_si128(lose, 4), _mm_srli_si128(nat, 4), _mm_srli_si128(surr, 4),
+                 a.bet + i + 4, net + i + 4, num, den);
+        setl4Sse(_mm_srli_si128(win, 8), _mm_srli_si128(lose, 8), _mm_srli_si128(nat, 8), _mm_srli_si128(surr, 8),
+                 a.bet + i + 8, net + i + 8, num, den);
+        setl4Sse(_mm_srli_si128(win, 12), _mm_srli_si128(lose, 12), _mm_srli_si128(nat, 12), _mm_srli_si128(surr, 12),
+                 a.bet + i + 12, net + i + 12, num, den);
+    }
+    setlScl(a, net, i, n);
+}
+
+// 8 natural pays, floor(bet * num / den), through double
+__attribute__((target("avx2")))
+static inline __m256i natAvx2(__m256i bet, __m256d num, __m256d den) {
+    __m256d lo = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(bet)), num), den);
+    __m256d hi = _mm256_div_pd(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(bet, 1)), num), den);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(lo)), _mm256_cvttpd_epi32(hi), 1);
+}
+
+// Deltas for 8 slots whose masks sit in the low 8 bytes of w, l, nt, s
+__attribute__((target("avx2")))
+static inline void setl8Avx2(__m128i w, __m128i l, __m128i nt, __m128i s, const int32_t* bet, int32_t* out,
+                             __m256d num, __m256d den) {
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bet));
+    __m256i d = _mm256_and_si256(_mm256_cvtepi8_epi32(w), b); // Win: +bet
+    d = _mm256_or_si256(d, _mm256_and_si256(_mm256_cvtepi8_epi32(l), _mm256_sub_epi32(_mm256_setzero_si256(), b)));
+    d = _mm256_or_si256(d, _mm256_and_si256(_mm256_cvtepi8_epi32(nt), natAvx2(b, num, den)));
+    d = _mm256_or_si256(d, _mm256_and_si256(_mm256_cvtepi8_epi32(s), _mm256_sub_epi32(_mm256_srai_epi32(b, 1), b)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), d);
+}
+
+// AVX2 kernel: 32 slots per pass
+__attribute__((target("avx2")))
+void setlAvx2(const SetlArgs& a, int32_t* net, int i0, int n) {
+    const __m256i k10 = _mm256_set1_epi8(10), k11 = _mm256_set1_epi8(11), k21 = _mm256_set1_epi8(21);
+    const __m256i kNat = _mm256_set1_epi8(HF_NAT), kSurr = _mm256_set1_epi8(HF_SURR);
+    const __m256i zero = _mm256_setzero_si256(), ones = _mm256_set1_epi8(-1);
+    const __m256d num = _mm256_set1_pd(a.bjNum), den = _mm256_set1_pd(a.bjDen);
+    int i = i0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i hard = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.hard + i));
+        __m256i aces = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.aces + i));
+        __m256i flg = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.flg + i));
+        __m256i ds = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.dScr + i));
+        __m256i dn = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a.dNat + i));
+        __m256i soft = _mm256_andnot_si256(_mm256_cmpgt_epi8(hard, k11), _mm256_cmpgt_epi8(aces, zero));
+        __m256i ps = _mm256_add_epi8(hard, _mm256_and_si256(soft, k10)); // Player score
+        __m256i bust = _mm256_cmpgt_epi8(ps, k21);
+        __m256i pNat = _mm256_cmpeq_epi8(_mm256_and_si256(flg, kNat), kNat);
+        __m256i surr = _mm256_cmpeq_epi8(_mm256_and_si256(flg, kSurr), kSurr);
+        __m256i dNat = _mm256_cmpgt_epi8(dn, zero);
+        __m256i dBust = _mm256_cmpgt_epi8(ds, k21);
+        __m256i rest = _mm256_andnot_si256(_mm256_or_si256(bust, pNat), ones); // Neither bust nor natural
+        __m256i live = _mm256_andnot_si256(dNat, rest); // Comes down to the dealer's total
+        __m256i win = _mm256_and_si256(live, _mm256_or_si256(dBust, _mm256_cmpgt_epi8(ps, ds)));
+        __m256i lose = _mm256_or_si256(bust, _mm256_and_si256(rest, dNat));
+        lose = _mm256_or_si256(lose, _mm256_andnot_si256(dBust, _mm256_and_si256(live, _mm256_cmpgt_epi8(ds, ps))));
+        __m256i nat = _mm256_andnot_si256(dNat, pNat);
+        win = _mm256_andnot_si256(surr, win); // Surrender overrides the rest
+        lose = _mm256_andnot_si256(surr, lose);
+        nat = _mm256_andnot_si256(surr, nat);
+
+        // Widen 8 lanes at a time: low and high 8 bytes of each 128-bit half
+        __m128i hw[2] = {_mm256_castsi256_si128(win), _mm256_extracti128_si256(win, 1)};
+        __m128i hl[2] = {_mm256_castsi256_si128(lose), _mm256_extracti128_si256(lose, 1)};
+        __m128i hn[2] = {_mm256_castsi256_si128(nat), _mm256_extracti128_si256(nat, 1)};
+        __m128i hs[2] = {_mm256_castsi256_si128(surr), _mm256_extracti128_si256(surr, 1)};
+        for (int h = 0; h < 2; ++h) {
+            int o = i + 16 * h;
+            setl8Avx2(hw[h], hl[h], hn[h], hs[h], a.bet + o, net + o, num, den);
+            setl8Avx2(_mm_srli_si128(hw[h], 8), _mm_srli_si128(hl[h], 8), _mm_srli_si128(hn[h], 8),
+                      _mm_srli_si128(hs[h], 8), a.bet + o + 8, net + o + 8, num, den);
+        }
+    }
+    setlScl(a, net, i, n);
+}
+#endif
+
+// Best kernel level this CPU supports
+SimdLvl cpuSimd() {
+#ifdef BJSIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLvl::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLvl::SSE41;
+#endif
+    return SimdLvl::SCALAR;
+}
+
+// Kernel for a level, capped at what the CPU supports
+SetlFn pickSetl(SimdLvl want) {
+    SimdLvl lvl = std::min(want, cpuSimd());
+#ifdef BJSIMD
+    if (lvl == SimdLvl::AVX2) return setlAvx2;
+    if (lvl == SimdLvl::SSE41) return setlSse;
+#endif
+    (void)lvl;
+    return setlScl;
+}
+
+// Settlement phase: broadcast each dealer result to its table's slots,
+// then settle every slot with the batch's kernel
+template <class R>
+void batSetl(TblBat& b, int nAct, const R& rul) {
+    int perTbl = b.nSeat * MAXHNDS;
+    for (int t = 0; t < nAct; ++t) {
+        uint8_t d = static_cast<uint8_t>(batScr(b.dHard[t], b.dAces[t]));
+        std::fill_n(&b.hDScr[t * perTbl], perTbl, d);
+        std::fill_n(&b.hDNat[t * perTbl], perTbl, b.dNat[t]);
+    }
+    SetlArgs a{b.hHard.data(), b.hAces.data(), b.hFlg.data(), b.hDScr.data(), b.hDNat.data(), b.hBet.data(),
+               rul.bjNum, rul.bjDen};
+    b.setl(a, b.hNet.data(), 0, nAct * perTbl);
+}
+
+// Adds the settled nets of tables [0, nAct) to tly
+inline void batTly(const TblBat& b, int nAct, Tally& tly) {
+    int nSeats = nAct * b.nSeat;
+    long long tblNet = 0; // Net over the current table's seats
+    for (int s = 0; s < nSeats; ++s) {
+        long long rndNet = 0; // Net for this seat's round
+        for (int k = 0; k < b.sHnds[s]; ++k) {
+            int i = s * MAXHNDS + k;
+            int net = b.hNet[i];
+            tly.hands++;
+            tly.wagered += b.hBet[i];
+            if (net > 0) tly.wins++;
+            else if (net < 0) tly.losses++;
+            else tly.pushes++;
+            if ((b.hFlg[i] & HF_NAT) && net > 0) tly.nats++;
+            tly.busts += b.hHard[i] > 21;
+            rndNet += net;
+        }
+        tly.rounds++;
+        tly.net += rndNet;
+        tly.seat[s % b.nSeat].add(static_cast<double>(rndNet));
+        tblNet += rndNet;
+        if (s % b.nSeat == b.nSeat - 1) { // Last seat of its table
+            tly.tblRnd.add(static_cast<double>(tblNet) / b.nSeat);
+            tblNet = 0;
+        }
+    }
+}
+
+// Batch Simulation Loop
+// Plays nRnds rounds spread over nTbl tables of nPlay seats, advancing
+// all tables one phase at a time. Table t plays on strm advanced by t
+// jumps; simd caps the settlement kernel.
+template <class R>
+void simBat(long long nRnds, int nPlay, int nTbl, const R& rul, Rng strm, SimdLvl simd, Tally& tly) {
+    TblBat b(nTbl, nPlay);
+    b.setl = pickSetl(simd); // Runtime dispatch on the CPU's features
+    Table proto; // Builds one ordered shoe to copy
+    createDk(proto, rul.decks);
+    for (int t = 0; t < nTbl; ++t) {
+        b.rngs[t] = strm; // Non-overlapping stream per table
+        strm.jump();
+        b.shoes[t] = proto.deck;
+        shufFY(b.shoes[t].begin(), b.shoes[t].size(), b.rngs[t]);
+    }
+    const BasTbl& tbl = BASTBL[rul.h17][rul.das];
+
+    long long passes = (nRnds + nTbl - 1) / nTbl; // Rounds on the busiest table
+    for (long long r = 0; r < passes; ++r) {
+        // The last pass plays only as many tables as it takes to reach nRnds
+        long long left = nRnds - r * nTbl;
+        int nAct = static_cast<int>(std::min<long long>(nTbl, left));
+        batBet(b, nAct, SIMUNIT, rul);
+        batDeal(b, nAct, rul);
+        batAct(b, nAct, tbl, rul);
+        batDlr(b, nAct, rul);
+        batSetl(b, nAct, rul);
+        batTly(b, nAct, tly);
+    }
+}
+
+// Run Options
+// Settings parsed from the command line
+struct RunOpts {
+    long long rnds = 0; // Rounds to simulate; 0 means interactive play
+    int plyrs = 1; // Seats at the simulated table
+    int thrds = 1; // Tables to run in parallel
+    uint64_t seed = 0; // Run seed
+    ShufAlg shufAlg = ShufAlg::FY; // Shuffle algorithm for the run
+    StratKind kind = StratKind::BASIC; // Simulated strategy
+    CntSys cntSys = CntSys::HILO; // Tag system for the running count
+    std::string logPath; // Binary event log file; empty for none
+    RuleSet rules; // House rules
+    int preset = 0; // Compiled rule set in use (index into RULNM), -1 for a custom one
+    int batch = 0; // Tables per thread played in lockstep by simBat; 0 uses playRnd
+    SimdLvl simd = SimdLvl::AVX2; // Widest settlement kernel allowed in batch mode
+    bool prof = false; // Time the round phases and print the profile at the end
+    int rpTbl = -1; // Table to replay a round of, or -1
+    long long rpRnd = 0; // Round to replay (1-based)
+    std::string ckPath; // Checkpoint file to save; empty for none
+    long long ckEvery = 0; // Rounds per table between checkpoints
+    std::string rsmPath; // Checkpoint to resume from; empty to start fresh
+    int port = 0; // TCP port to serve tables on; 0 for no server
+    bool shufAhd = false; // Prepare simulated tables' reshuffles on a background thread
+    bool quiet = false; // Interactive play without the table display, prompts only
+    std::string recPath; // Replay file to record; empty for none
+    std::string vfyPath; // Replay file to verify; empty for none
+    long long vfyRnd = 0; // Round to verify (1-based), 0 for every round
+    double prec = 0.0; // Stop once the 95% interval on EV is this narrow (% of the bet); 0 runs every round
+    int bankU = 100; // Bankroll in bet units for the risk of ruin
+};
+
+// Names of the compiled rule sets, in dispatch order
+const char* const RULNM[] = {"standard", "vegas", "euro"};
+
+// One-line summary of a rule set
+std::string rulDesc(const RuleSet& rs) {
+    std::ostringstream out;
+    out << rs.decks << " decks, cut at " << rs.cut << ", " << (rs.h17 ? "H17" : "S17") << ", BJ pays "
+        << rs.bjNum << ":" << rs.bjDen << ", " << (rs.das ? "DAS" : "no DAS") << ", split to " << rs.spltHnds
+        << (rs.surr ? ", surrender" : "") << (rs.enhc ? ", no hole card" : "");
+    return out.str();
+}
+
+// Replay file header for a run
+RpHdr mkRpHdr(const RunOpts& opt, const RuleSet& rs) {
+    RpHdr h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, RPMAGIC, sizeof(RPMAGIC));
+    h.vers = RPVERS;
+    h.seed = opt.seed;
+    h.preset = opt.preset;
+    h.shufAlg = static_cast<int32_t>(opt.shufAlg);
+    const int32_t rul[9] = {rs.decks, rs.cut, rs.h17, rs.bjNum, rs.bjDen, rs.das, rs.spltHnds, rs.surr, rs.enhc};
+    std::memcpy(h.rul, rul, sizeof(rul));
+    return h;
+}
+
+// Main Game Loop
+// Plays interactively at one table
+void runGame(const RunOpts& opt) {
+    Table tbl; // The table's shoe, discard pile and turn queue
+    tbl.rng.seed(opt.seed);
+    tbl.shufAlg = opt.shufAlg;
+    tbl.cnt.sys = &TAGSYS[static_cast<int>(opt.cntSys)];
+    std::unique_ptr<EvtLog> log; // Optional event log
+    std::unique_ptr<EvtBuf> evts;
+    if (!opt.logPath.empty()) {
+        log.reset(new EvtLog(opt.logPath));
+        evts.reset(new EvtBuf(log.get(), 0));
+        tbl.evts = evts.get();
+    }
+    std::unique_ptr<RpLog> rpLog; // Optional replay recording
+    std::unique_ptr<RpBuf> rec;
+    if (!opt.recPath.empty()) {
+        rpLog.reset(new RpLog(opt.recPath, mkRpHdr(opt, opt.rules)));
+        rec.reset(new RpBuf(rpLog.get(), 0, rpMaxBet(opt.rules.bjNum)));
+        tbl.rec = rec.get();
+    }
+    if (opt.prof) tbl.prof.start();
+    PlyrReg plyrs(3); // Registered players, by id
+    Player dealr = {0, "Dealer", 0}; // Dealer player
+    dealr.hands.emplace_back(); // Dealer always has one hand
+    ConStrat strat; // Bets and actions typed at the console
+    const RuleSet& rul = opt.rules; // Interactive play reads the rules at run time
+
+    std::cout << "### Welcome to Blackjack Casino ###\n";
+
+    // Setup Players
+    int numPlay = 0; // Number of players input
+    while (numPlay < 1 || numPlay > 3) {
+        std::cout << "Enter number of players (1-3): ";
+        std::cin >> numPlay; // Input number of players
+        clear_in();
+    }
+
+    for (int i = 1; i <= numPlay; ++i) { // Get player names
+        std::string name; // Player name input
+        std::cout << "Enter name for Player " << i << ": ";
+        std::getline(std::cin, name); // Input player name
+        plyrs.add(name, 1000); // Takes id i
+    }
+
+    // Initial Deck Setup
+    createDk(tbl, rul.decks); // Create the shoe for the rules
+    shufDk(tbl); // Shuffle the deck
+
+    // Play Again Loop
+    std::string playAgn = "Y";
+
+    while (playAgn == "Y") { // While player wants to play again
+        try {
+            // Check for players who are out of money
+            // Lambda predicate frees the slots of broke players
+            plyrs.dropIf([&](const Player& p) { // Lambda to check if player is out of chips
+                if (p.chips < 1) { // If player has no chips
+                    std::cout << "\n" << p.name << " is out of chips and leaves the game.\n";
+                    return true;
+                }
+                return false; // Keep player otherwise
+            });
+
+            // Check if any players remain
+            if (plyrs.empty()) { // No players left
+                std::cout << "\nAll players are out of chips. Game Over.\n";
+                break;
+            }
+
+            // Check if dealer's hand needs reset
+            if (!dealr.hands.empty() && dealr.hands.front().bet > 0) { // If dealer's hand has cards
+                 discHnd(tbl, dealr.hands.front()); // Discard dealer's hand
+            } else if (dealr.hands.empty()) { // If dealer has no hands
+                dealr.hands.emplace_back(); // Create dealer's hand
+            }
+
+            // Play a round of Blackjack
+            if (opt.quiet) playRnd<false>(tbl, plyrs, dealr, strat, rul); // Display compiled out
+            else playRnd<true>(tbl, plyrs, dealr, strat, rul);
+
+        } catch (const std::exception& e) { // Catch any critical errors
+            std::cerr << "CRITICAL GAME ERROR: " << e.what() << "\n";
+            break;
+        }
+
+        // Round Summary after each round
+        std::cout << "\n" << std::string(50, '*') << "\n";
+        std::cout << "Round Summary:\n"; // Summarize player chips
+
+        // STL Algorithm: std::for_each to display final chips
+        std::for_each(plyrs.begin(), plyrs.end(), [](const Player& p) {
+            prntStat(p, false); // Print player stats without hands
+
+        });
+
+        // Prompt to play again or not
+        std::cout << "\n" << std::string(50, '*') << "\n";
+        std::cout << "Play another round? (Y/N): ";
+        std::cin >> playAgn; // Input choice
+        std::transform(playAgn.begin(), playAgn.end(), playAgn.begin(), ::toupper);
+
+        // Clear input buffer
+        clear_in();
+
+    }
+
+    // If player chooses not to play again or all players are out
+    std::cout << "\nThank you for playing Blackjack. Final Chip Counts:\n";
+    std::for_each(plyrs.begin(), plyrs.end(), [](const Player& p) { // Final stats
+        prntStat(p, false); // Print player stats without hands
+    });
+    if (PROF && opt.prof) prntProf(tbl.prof.snap());
+
+    std::cout << "Goodbye!\n";
+}
+
+// Simulation Loop
+// Plays nRnds headless rounds for nPlay seats at one table, adding the
+// results to tly. Touches nothing outside its own table.
+template <class R>
+void simTbl(Table& tbl, long long nRnds, int nPlay, StratKind kind, const R& rul, Tally& tly, bool loudLast = false,
+            bool fresh = true) {
+    PlyrReg plyrs(nPlay); // Simulated seats
+    Player dealr = {0, "Dealer", 0}; // Dealer player
+    dealr.hands.emplace_back(); // Dealer always has one hand
+    std::unique_ptr<Strat> strat = mkStrat(kind, tbl, dealr, toRules(rul)); // Automated bets and decisions
+
+    for (int i = 1; i <= nPlay; ++i) { // Create the seats
+        plyrs.add("Seat " + std::to_string(i), SIMBANK);
+    }
+
+    // Initial Deck Setup (a table continuing a run keeps its shoe)
+    if (fresh) {
+        createDk(tbl, rul.decks); // Create the shoe for the rules
+        shufDk(tbl); // Shuffle the deck
+    }
+
+    for (long long r = 0; r < nRnds; ++r) {
+        // Every round starts from the same bankroll so no seat can go broke
+        for (auto& p : plyrs) p.chips = SIMBANK;
+        if (loudLast && r == nRnds - 1) playRnd<true>(tbl, plyrs, dealr, *strat, rul, &tly); // Round being replayed
+        else playRnd<false>(tbl, plyrs, dealr, *strat, rul, &tly); // Silent round
+    }
+}
+
+// Checkpoints
+// A long simulation can save its state every N rounds per table and pick
+// up from the last save. The file holds a header with the run's settings,
+// then for each table a fixed record (rounds played, generator state,
+// shoe cursors, running count, tally) followed by its shoe, one byte per
+// card. Saves happen between rounds, when every card is back in the shoe.
+// Each save goes to a temporary file that is renamed over the previous
+// one, so an interrupted write leaves the last checkpoint intact.
+const char CKMAGIC[4] = {'B', 'J', 'C', 'K'};
+const uint32_t CKVERS = 3; // Checkpoint layout version
+
+// Checkpoint header: the settings a resumed run must share
+struct CkHdr {
+    char magic[4];
+    uint32_t vers;
+    uint64_t seed; // Run seed
+    int64_t rnds; // Rounds in the whole run
+    double secs; // Simulation time spent so far
+    int32_t thrds, plyrs, kind, shufAlg, cntSys, preset;
+    int32_t rul[9]; // RuleSet fields in declaration order
+};
+
+// Checkpoint record for one table
+struct CkTbl {
+    int64_t done; // Rounds played
+    uint64_t rng[4]; // Generator state
+    int32_t len, pos, nDisc; // Shoe cursors
+    int32_t run; // Running count
+    Tally tly; // Results so far
+};
+static_assert(sizeof(CkTbl) == 320, "CkTbl must stay free of padding");
+
+// Header for a run; zeroed first so padding bytes are written as zero
+CkHdr mkCkHdr(const RunOpts& opt, const RuleSet& rs, double secs) {
+    CkHdr h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, CKMAGIC, sizeof(CKMAGIC));
+    h.vers = CKVERS;
+    h.seed = opt.seed;
+    h.rnds = opt.rnds;
+    h.secs = secs;
+    h.thrds = opt.thrds;
+    h.plyrs = opt.plyrs;
+    h.kind = static_cast<int32_t>(opt.kind);
+    h.shufAlg = static_cast<int32_t>(opt.shufAlg);
+    h.cntSys = static_cast<int32_t>(opt.cntSys);
+    h.preset = opt.preset;
+    const int32_t rul[9] = {rs.decks, rs.cut, rs.h17, rs.bjNum, rs.bjDen, rs.das, rs.spltHnds, rs.surr, rs.enhc};
+    std::memcpy(h.rul, rul, sizeof(rul));
+    return h;
+}
+
+// Writes the state of every table to path, atomically replacing it
+void saveCk(const std::string& path, const CkHdr& hdr, const std::vector<std::unique_ptr<Table>>& tbls,
+            const std::vector<long long>& done, const std::vector<Tally>& parts) {
+    std::string tmp = path + ".tmp"; // Renamed over path once complete
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot write checkpoint " + tmp);
+        out.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        for (size_t t = 0; t < tbls.size(); ++t) {
+            const Table& tb = *tbls[t];
+            CkTbl rec{}; // Every field is set below; the record has no padding
+            rec.done = done[t];
+            std::memcpy(rec.rng, tb.rng.s, sizeof(rec.rng));
+            rec.len = tb.deck.len;
+            rec.pos = tb.deck.pos;
+            rec.nDisc = tb.deck.nDisc;
+            rec.run = tb.cnt.run;
+            rec.tly = parts[t];
+            out.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+            out.write(reinterpret_cast<const char*>(tb.deck.cards), tb.deck.len);
+        }
+        out.flush();
+        if (!out) throw std::runtime_error("Cannot write checkpoint " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) throw std::runtime_error("Cannot replace checkpoint " + path);
+}
+
+// Restores every table from a checkpoint written by a run with the same
+// settings (hdr); returns the simulation time the run had already spent
+double loadCk(const std::string& path, const CkHdr& hdr, std::vector<std::unique_ptr<Table>>& tbls,
+              std::vector<long long>& done, std::vector<Tally>& parts) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open checkpoint " + path);
+    CkHdr got;
+    in.read(reinterpret_cast<char*>(&got), sizeof(got));
+    if (!in || std::memcmp(got.magic, CKMAGIC, sizeof(CKMAGIC)) != 0 || got.vers != CKVERS) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    double secs = got.secs;
+    got.secs = hdr.secs; // Everything else must match
+    if (std::memcmp(&got, &hdr, sizeof(hdr)) != 0) {
+        throw std::runtime_error("Checkpoint " + path + " was written with different settings");
+    }
+    for (size_t t = 0; t < tbls.size(); ++t) {
+        Table& tb = *tbls[t];
+        CkTbl rec;
+        in.read(reinterpret_cast<char*>(&rec), sizeof(rec));
+        if (!in || rec.len < 0 || rec.len > MAXDK * DKSIZE || rec.pos < 0 || rec.pos > rec.len ||
+            rec.nDisc != (hdr.shufAlg == static_cast<int32_t>(ShufAlg::CSM) ? 0 : rec.pos)) { // Nothing in play
+            throw std::runtime_error("Checkpoint " + path + " is damaged");
+        }
+        in.read(reinterpret_cast<char*>(tb.deck.cards), rec.len);
+        if (!in) throw std::runtime_error("Checkpoint " + path + " is truncated");
+        done[t] = rec.done;
+        std::memcpy(tb.rng.s, rec.rng, sizeof(rec.rng));
+        tb.deck.len = rec.len;
+        tb.deck.pos = rec.pos;
+        tb.deck.nDisc = rec.nDisc;
+        tb.cnt.run = rec.run;
+        tb.cnt.holeDn = false;
+        parts[t] = rec.tly;
+    }
+    return secs;
+}
+
+// Round Replay
+// Replays round rnd (1-based, as numbered in the event log) of table idx
+// from a simulation with the same seed and options. The table's stream
+// depends only on (seed, idx), so the earlier rounds are played silently
+// to rebuild its shoe and the requested round is played with full output.
+template <class R>
+void replayR(const RunOpts& opt, const R& rul) {
+    std::unique_ptr<Table> tbl(new Table);
+    tbl->rng = tblRng(opt.seed, opt.rpTbl);
+    tbl->shufAlg = opt.shufAlg;
+    tbl->cnt.sys = &TAGSYS[static_cast<int>(opt.cntSys)];
+    std::cout << "### Replay: seed " << opt.seed << ", table " << opt.rpTbl << ", round " << opt.rpRnd << " ###\n";
+    Tally tly; // Results of the replayed rounds
+    simTbl(*tbl, opt.rpRnd, opt.plyrs, opt.kind, rul, tly, true);
+}
+
+// Simulation Runner
+// Splits the rounds across independent tables, one per thread, each with
+// its own stream jumped from the run seed. Every thread fills its own
+// Tally and the tallies are merged after join, so the hot path shares
+// nothing (event log blocks are handed off only once per EVBLK records).
+// With checkpoints the threads stop every ckEvery rounds for a save.
+// R is the rule set the tables are compiled for.
+template <class R>
+void runSimR(const RunOpts& opt, const R& rul) {
+    const long long nRnds = opt.rnds; // Rounds in total
+    const int nPlay = opt.plyrs; // Seats per table
+    const int nThr = opt.thrds; // Tables, one per thread
+    const ShufAlg alg = opt.shufAlg;
+    const StratKind kind = opt.kind;
+    const TagSys* tags = &TAGSYS[static_cast<int>(opt.cntSys)];
+    const int batch = opt.batch;
+    const SimdLvl simd = opt.simd;
+    const bool prof = opt.prof;
+    const int unit = SIMUNIT; // Bet unit of the simulated strategies
+    std::vector<Tally> parts(nThr); // One result slot per thread
+    std::vector<ProfSnap> profs(nThr); // Each table's instrumentation
+    std::vector<std::thread> pool; // Worker threads
+    std::vector<Rng> strms; // Each table's stream (for batches, the first table's)
+    Rng strm(opt.seed); // Master stream; each table takes the next jump of it
+    for (int t = 0; t < nThr; ++t) {
+        strms.push_back(strm);
+        for (int j = 0; j < std::max(batch, 1); ++j) strm.jump(); // Past every table this thread plays
+    }
+    std::unique_ptr<EvtLog> log; // Optional shared event log writer
+    if (!opt.logPath.empty()) log.reset(new EvtLog(opt.logPath));
+    EvtLog* lg = log.get();
+    auto shareOf = [&](int t) { return nRnds / nThr + (t < nRnds % nThr); }; // Rounds for table t
+
+    // playRnd tables live outside the threads so they survive between checkpoints
+    std::unique_ptr<ShufPool> shuf; // Shuffler for every table, with --shuffle-ahead
+    if (opt.shufAhd && batch == 0) shuf.reset(new ShufPool);
+    std::vector<std::unique_ptr<Table>> tbls;
+    std::vector<std::unique_ptr<EvtBuf>> bufs; // Each table's records, if logging
+    std::unique_ptr<RpLog> rpLog; // Optional replay recording
+    if (!opt.recPath.empty() && batch == 0) rpLog.reset(new RpLog(opt.recPath, mkRpHdr(opt, toRules(rul))));
+    std::vector<std::unique_ptr<RpBuf>> rpBufs; // Each table's replay records
+    std::vector<long long> done(nThr, 0); // Rounds each table has played
+    double prevSecs = 0.0; // Time spent before a resumed checkpoint
+    if (batch == 0) {
+        for (int t = 0; t < nThr; ++t) {
+            tbls.emplace_back(new Table);
+            Table& tb = *tbls.back();
+            tb.rng = strms[t];
+            tb.shufAlg = alg;
+            tb.cnt.sys = tags;
+            if (lg) {
+                bufs.emplace_back(new EvtBuf(lg, t));
+                tb.evts = bufs.back().get();
+            }
+            if (rpLog) {
+                rpBufs.emplace_back(new RpBuf(rpLog.get(), t, rpMaxBet(rul.bjNum)));
+                tb.rec = rpBufs.back().get();
+            }
+            if (prof) tb.prof.start();
+            if (shuf) shuf->join(tb);
+        }
+        if (!opt.rsmPath.empty()) {
+            prevSecs = loadCk(opt.rsmPath, mkCkHdr(opt, toRules(rul), 0.0), tbls, done, parts);
+            long long played = 0;
+            for (long long d : done) played += d;
+            std::cout << "Resumed " << opt.rsmPath << " at round " << played << " of " << nRnds << "\n";
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now(); // Throughput timer
+    if (batch > 0) {
+        for (int t = 0; t < nThr; ++t) {
+            pool.emplace_back([=, &parts]() {
+                Tally tly; // Thread-local, written back once at the end
+                simBat(shareOf(t), nPlay, batch, rul, strms[t], simd, tly); // Batched tables with their own streams
+                parts[t] = tly;
+            });
+        }
+        for (auto& th : pool) th.join(); // Wait for every table
+    } else {
+        // Tables play in chunks of ckEvery rounds, stopping to save a checkpoint
+        // or check the precision after each chunk; otherwise the whole share
+        // is one chunk
+        const long long ckEvery = !opt.ckPath.empty() ? opt.ckEvery : opt.prec > 0 ? STATCHNK : nRnds;
+        bool more = true;
+        while (more) {
+            for (int t = 0; t < nThr; ++t) {
+                pool.emplace_back([=, &tbls, &done, &parts]() {
+                    long long n = std::min(ckEvery, shareOf(t) - done[t]); // Rounds in this chunk
+                    if (n <= 0) return;
+                    Tally tly = parts[t]; // Thread-local, written back at the end of the chunk
+                    simTbl(*tbls[t], n, nPlay, kind, rul, tly, false, done[t] == 0);
+                    parts[t] = tly;
+                    done[t] += n;
+                });
+            }
+            for (auto& th : pool) th.join(); // Wait for every table
+            pool.clear();
+            more = false;
+            for (int t = 0; t < nThr; ++t) more |= done[t] < shareOf(t);
+            if (!opt.ckPath.empty()) {
+                double sofar = prevSecs + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                saveCk(opt.ckPath, mkCkHdr(opt, toRules(rul), sofar), tbls, done, parts);
+            }
+            if (opt.prec > 0 && more) { // Live estimate, and stop once it is tight enough
+                Tally sum;
+                for (const auto& pt : parts) sum += pt;
+                const RunStat& st = sum.tblRnd; // One sample per table-round
+                double hw = 100.0 * Z95 * st.sem() / unit; // Half-width of the 95% interval
+                std::cout << std::setprecision(4) << "  " << st.n << " rounds: EV " << 100.0 * st.mean / unit
+                          << "% +/- " << hw << "%\n" << std::setprecision(0) << std::flush;
+                if (st.n > 1 && hw <= opt.prec) more = false;
+            }
+        }
+        for (int t = 0; t < nThr; ++t) profs[t] = tbls[t]->prof.snap();
+    }
+    bufs.clear(); // Hand off the last partial blocks
+    log.reset(); // Flush and close the event log
+    rpBufs.clear(); // Append the last replay records
+    rpLog.reset();
+    double secs = prevSecs + std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Merge per-thread counters
+    Tally tly;
+    for (const auto& pt : parts) tly += pt;
+
+    // Per-round statistics, in units of the flat bet. The interval comes
+    // from table-rounds; the variance is a single seat's
+    double mean = tly.tblRnd.mean; // Mean net per seat-round
+    double var = tly.all().var(); // Variance of one seat's round
+    double hw = Z95 * tly.tblRnd.sem(); // Half-width of the 95% interval on the mean
+    double hands = static_cast<double>(tly.hands ? tly.hands : 1); // Avoid divide by zero
+    long long played = tly.rounds / nPlay; // Below nRnds when the precision was reached early
+
+    std::cout << "### Blackjack Simulation ###\n";
+    if (played < nRnds) std::cout << "Stopped early: EV known to +/- " << std::setprecision(4) << opt.prec << "%\n";
+    std::cout << "Rounds: " << played << "  Seats: " << nPlay << "  Threads: " << nThr << "  Hands: " << tly.hands
+              << "  Seed: " << opt.seed << "\n";
+    std::cout << "Rules: " << (opt.preset >= 0 ? RULNM[opt.preset] : "custom") << " (" << rulDesc(toRules(rul)) << ")\n";
+    if (batch > 0) {
+        std::cout << "Batch: " << batch << " tables per thread, "
+                  << SIMDNM[static_cast<int>(std::min(simd, cpuSimd()))] << " settlement\n";
+    }
+    std::cout << std::setprecision(2);
+    std::cout << "Wins: " << 100.0 * tly.wins / hands << "%  Losses: " << 100.0 * tly.losses / hands
+              << "%  Pushes: " << 100.0 * tly.pushes / hands << "%  Naturals: " << 100.0 * tly.nats / hands << "%\n";
+    std::cout << "Busts: " << 100.0 * tly.busts / hands << "% of hands\n";
+    std::cout << std::setprecision(4);
+    std::cout << "EV per round: " << 100.0 * mean / unit << "% of initial bet (95% CI " << 100.0 * (mean - hw) / unit
+              << "% to " << 100.0 * (mean + hw) / unit << "%)\n";
+    std::cout << "Variance per round: " << var / (1.0 * unit * unit) << " (units^2)  Std Dev: " << std::sqrt(var) / unit << " units\n";
+    if (nPlay > 1) { // Seats see different cards, so their results differ a little
+        for (int i = 0; i < nPlay; ++i) {
+            const RunStat& ss = tly.seat[i];
+            std::cout << "  Seat " << i + 1 << ": EV " << 100.0 * ss.mean / unit << "% +/- "
+                      << 100.0 * Z95 * ss.sem() / unit << "%\n";
+        }
+    }
+    // Diffusion approximation for a flat bettor: exp(-2 * mean * bankroll / variance)
+    double ror = mean > 0 && var > 0 ? std::exp(-2.0 * mean * opt.bankU * unit / var) : 1.0;
+    std::cout << std::setprecision(2) << "Risk of ruin: " << 100.0 * ror << "% with " << opt.bankU << " units\n"
+              << std::setprecision(4);
+    std::cout << "Net: $" << tly.net << " on $" << tly.wagered << " wagered\n";
+    std::cout << std::setprecision(2);
+    std::cout << "Time: " << secs << " s (" << std::setprecision(0) << (secs > 0 ? tly.hands / secs : 0) << " hands/sec)\n";
+    if (PROF && prof && batch == 0) { // Batch tables do not run playRnd
+        ProfSnap ps;
+        for (const auto& p : profs) ps += p;
+        prntProf(ps);
+    }
+}
+
+// Runs the simulation with the compiled rule set when one was chosen,
+// else with the runtime RuleSet
+void runSim(const RunOpts& opt) {
+    if (opt.rpTbl >= 0) {
+        switch (opt.preset) {
+            case 0: replayR(opt, RulStd()); break;
+            case 1: replayR(opt, RulVegas()); break;
+            case 2: replayR(opt, RulEuro()); break;
+            default: replayR(opt, opt.rules); break;
+        }
+        return;
+    }
+    switch (opt.preset) {
+        case 0: runSimR(opt, RulStd()); break;
+        case 1: runSimR(opt, RulVegas()); break;
+        case 2: runSimR(opt, RulEuro()); break;
+        default: runSimR(opt, opt.rules); break;
+    }
+}
+
+// Index Search
+// Finds the true count at which a play should deviate from basic
+// strategy. Tables play one seat of basic strategy; when a candidate's
+// hand comes up, the probe strategy pauses the round (stepRnd's "not
+// yet") and the whole round is copied. One copy finishes with the
+// deviation and the other with the usual play, both drawing the same
+// cards, so the difference in net is measured with common random numbers
+// and most of the shoe's noise cancels. Every candidate is probed in the
+// same pass, so each shoe serves all of them. Gains are binned by the
+// true count at the decision, and the index is where a weighted line
+// through the bins crosses zero.
+
+// Candidate deviation: dev over base for a hard total against an upcard
+struct IdxPlay {
+    int tot; // Player's hard total (pairs excluded)
+    int up; // Dealer upcard, hard value (Ace = 1)
+    char dev; // Deviation
+    char base; // Play it is compared with
+};
+
+// The common multi-deck index plays; surrenders only under late surrender
+const IdxPlay IDXPLAYS[] = {
+    {16, 10, 'S', 'H'}, {15, 10, 'S', 'H'}, {10, 10, 'D', 'H'}, {12, 3, 'S', 'H'}, {12, 2, 'S', 'H'},
+    {11, 1, 'D', 'H'},  {9, 2, 'D', 'H'},   {10, 1, 'D', 'H'},  {9, 7, 'D', 'H'},  {16, 9, 'S', 'H'},
+    {13, 2, 'H', 'S'},  {12, 4, 'H', 'S'},  {12, 5, 'H', 'S'},  {12, 6, 'H', 'S'}, {13, 3, 'H', 'S'},
+    {14, 10, 'R', 'H'}, {15, 9, 'R', 'H'},  {15, 1, 'R', 'H'},
+};
+
+// Count bins: floor of the true count (running count for unbalanced
+// systems), clamped to [IDXLO, IDXHI]
+const int IDXLO = -30;
+const int IDXHI = 30;
+const int IDXBINS = IDXHI - IDXLO + 1;
+const long long IDXRNDS = 100000000; // Rounds searched unless --simulate says otherwise
+const long long IDXBLK = 100000; // Rounds per task
+const long long IDXMIN = 200; // Decisions a bin needs to take part in the fit
+
+// Probe Strategy
+// Basic strategy that pauses at the first decision of a round matching a
+// candidate, and answers one forced action when resumed
+struct IdxProbe : BasStrat {
+    const Table& tbl; // Table whose count bins the decision
+    const std::vector<IdxPlay>& plays; // Candidates
+    int which[22][11]; // Candidate for (hard total, upcard), or -1
+    bool armed = false; // Still looking for a candidate this round
+    char force = 0; // Answer for the pending decision
+    int cand = 0; // Candidate of the paused decision
+    int bin = 0; // Count bin of the paused decision
+
+    IdxProbe(const Table& t, const std::vector<IdxPlay>& ps, const RuleSet& rul)
+        : BasStrat(rul.h17, rul.das), tbl(t), plays(ps) {
+        std::memset(which, -1, sizeof(which));
+        for (size_t i = 0; i < ps.size(); ++i) which[ps[i].tot][ps[i].up] = static_cast<int>(i);
+    }
+
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        if (force) {
+            char act = force;
+            force = 0;
+            return act;
+        }
+        int c = armed && !isSoft(hand) && hand.hard < 22 ? which[hand.hard][upCrd.hard()] : -1;
+        bool pair = hand.cards.size() == 2 && hand.cards[0].hard() == hand.cards[1].hard();
+        if (c >= 0 && !pair) {
+            const IdxPlay& ip = plays[c];
+            bool dbl = ip.dev == 'D' || ip.base == 'D', surr = ip.dev == 'R' || ip.base == 'R';
+            if ((dbl && !canDbl) || (surr && !canSurr)) c = -1;
+        }
+        if (c >= 0 && !pair) {
+            armed = false;
+            cand = c;
+            int tc = static_cast<int>(std::floor(trueCnt(tbl)));
+            bin = std::max(IDXLO, std::min(IDXHI, tc)) - IDXLO;
+            return 0; // Pause here so the round can be copied
+        }
+        return BasStrat::getAct(p, hand, upCrd, canSplt, canDbl, canSurr);
+    }
+};
+
+// Work-Stealing Pool
+// Each worker takes tasks from the back of its own queue and, once that
+// is empty, steals from the front of the others', so plays that come up
+// rarely (and fork less) do not leave threads idle at the end
+struct WsPool {
+    struct Que {
+        std::mutex mtx; // Guards tasks
+        std::deque<int> tasks; // Task ids
+    };
+    std::vector<std::unique_ptr<Que>> ques; // One queue per worker
+
+    explicit WsPool(int n) {
+        for (int i = 0; i < n; ++i) ques.emplace_back(new Que);
+    }
+
+    void push(int w, int task) {
+        std::lock_guard<std::mutex> lk(ques[w]->mtx);
+        ques[w]->tasks.push_back(task);
+    }
+
+    // Next task for worker w; false once every queue is empty
+    bool pop(int w, int& task) {
+        int n = static_cast<int>(ques.size());
+        for (int k = 0; k < n; ++k) {
+            Que& q = *ques[(w + k) % n];
+            std::lock_guard<std::mutex> lk(q.mtx);
+            if (q.tasks.empty()) continue;
+            if (k == 0) { // Own queue: newest first
+                task = q.tasks.back();
+                q.tasks.pop_back();
+            } else { // Steal the oldest
+                task = q.tasks.front();
+                q.tasks.pop_front();
+            }
+            return true;
         }
+        return false;
+    }
 
-    } // end while (it != p.hands.end())
-}
+    // Runs body(worker, task) on n threads until the tasks run out
+    template <class F>
+    void run(F body) {
+        std::vector<std::thread> thrs;
+        for (int w = 0; w < static_cast<int>(ques.size()); ++w) {
+            thrs.emplace_back([this, w, &body]() {
+                int task;
+                while (pop(w, task)) body(w, task);
+            });
+        }
+        for (auto& th : thrs) th.join();
+    }
+};
 
-// Plays a single round of Blackjack for all players and the dealer.
-void playRnd(std::list<Player>& plyrs, Player& dealr) {
-    
-    // Bets and Initial Deal
-    std::cout << "\n" << std::string(50, '=') << "\n"; // Round header
-    std::cout << "                NEW ROUND STARTING\n";
-    std::cout << std::string(50, '=') << "\n";
-
-    // Reshuffle check
-    if (deck.size() < 60) { // Threshold for reshuffle
-        std::cout << "Deck size (" << deck.size() << ") is low. Performing full reshuffle.\n";
-        createDk(4); // Recreate deck with 4 decks
-        shufDk(); // Shuffle the deck
-    }
-    //  Store initial chips for all players (STL Map)
-    std::map<std::string, int> initChp;
-
-    // STL Algorithm: std::for_each to populate the map
-    std::for_each(plyrs.cbegin(), plyrs.cend(), [&](const Player& p) {
-        initChp[p.name] = p.chips; // Map insert/assignment
+// Searches every candidate play. Each task plays IDXBLK rounds on its
+// own block of the run's stream.
+template <class R>
+void idxSrchR(const RunOpts& opt, const R& rul) {
+    const RuleSet rs = toRules(rul);
+    std::vector<IdxPlay> plays;
+    for (const IdxPlay& ip : IDXPLAYS) {
+        if (rul.surr || (ip.dev != 'R' && ip.base != 'R')) plays.push_back(ip);
+    }
+    const long long nRun = opt.rnds > 0 ? opt.rnds : IDXRNDS;
+    const int nBlk = static_cast<int>((nRun + IDXBLK - 1) / IDXBLK);
+    const int nPl = static_cast<int>(plays.size());
+    const int nThr = opt.thrds;
+    const TagSys* tags = &TAGSYS[static_cast<int>(opt.cntSys)];
+    std::vector<Rng> strms; // Each block's stream
+    Rng strm(opt.seed);
+    for (int b = 0; b < nBlk; ++b) {
+        strms.push_back(strm);
+        strm.jump();
+    }
+
+    WsPool pool(nThr);
+    for (int b = 0; b < nBlk; ++b) pool.push(b % nThr, b);
+    std::vector<RunStat> gain(static_cast<size_t>(nThr) * nPl * IDXBINS); // Per worker, play and bin
+    std::vector<long long> fork(nThr, 0); // Rounds copied per worker
+
+    auto start = std::chrono::steady_clock::now();
+    pool.run([&](int w, int blk) {
+        long long nRnds = std::min(IDXBLK, nRun - blk * IDXBLK);
+        RunStat* out = &gain[static_cast<size_t>(w) * nPl * IDXBINS]; // This worker's bins
+
+        std::unique_ptr<Table> tbl(new Table), ftbl(new Table); // The round and its copy
+        tbl->rng = strms[blk];
+        tbl->shufAlg = opt.shufAlg;
+        tbl->cnt.sys = tags;
+        createDk(*tbl, rul.decks);
+        shufDk(*tbl);
+        PlyrReg plyrs(1), fplyrs(1);
+        plyrs.add("Seat 1", SIMBANK);
+        Player dealr = {0, "Dealer", 0}, fdealr;
+        dealr.hands.emplace_back();
+        IdxProbe probe(*tbl, plays, rs), fprobe(*ftbl, plays, rs);
+
+        for (long long r = 0; r < nRnds; ++r) {
+            plyrs[1].chips = SIMBANK;
+            RndSt st;
+            Tally tly; // This round's net on the usual line
+            probe.armed = true;
+            if (stepRnd<false>(*tbl, plyrs, dealr, probe, rul, st, &tly)) continue; // Candidate did not come up
+            *ftbl = *tbl; // Copy the paused round
+            fplyrs = plyrs;
+            fdealr = dealr;
+            RndSt fst = st;
+            Tally ftly;
+            const IdxPlay& ip = plays[probe.cand];
+            fprobe.force = ip.dev;
+            probe.force = ip.base;
+            bool done = stepRnd<false>(*ftbl, fplyrs, fdealr, fprobe, rul, fst, &ftly);
+            done = stepRnd<false>(*tbl, plyrs, dealr, probe, rul, st, &tly) && done;
+            if (!done) throw std::logic_error("Index probe left a decision pending");
+            out[probe.cand * IDXBINS + probe.bin].add(static_cast<double>(ftly.net - tly.net) / SIMUNIT);
+            ++fork[w];
+        }
     });
-    
-    // Place Bets and set up Turn Queue (STL Container: std::queue)
-    std::for_each(plyrs.begin(), plyrs.end(), [&](Player& p) {
-        int betAmt = 0; // Bet amount input
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long forks = 0;
+    for (long long f : fork) forks += f;
 
-        // Prompt for bet until valid
-        while (betAmt < 1 || betAmt > p.chips) { // Invalid bet
-            std::cout << p.name << " (Chips: $" << p.chips << "), place your bet: ";
-            std::cin >> betAmt; // Input bet amount
-            clear_in();
-            if (betAmt < 1 || betAmt > p.chips) { // Invalid bet
-                std::cout << "Invalid bet. Must be between $1 and $" << p.chips << ".\n";
+    std::cout << "### Index Search ###\n";
+    std::cout << "Rules: " << (opt.preset >= 0 ? RULNM[opt.preset] : "custom") << " (" << rulDesc(rs) << ")\n";
+    std::cout << "Count: " << tags->name << "  Rounds: " << nRun << "  Seed: " << opt.seed
+              << "  Threads: " << nThr << "\n";
+    std::cout << std::left << std::setw(10) << "Hand" << std::setw(14) << "Play" << std::setw(12) << "Index"
+              << std::right << std::setw(10) << "Decisions" << std::setw(12) << "Gain/TC" << "\n";
+    const char* ACTNM = "HSDR";
+    const char* const ACTSTR[] = {"hit", "stand", "double", "surr"};
+    auto actNm = [&](char a) { return ACTSTR[std::strchr(ACTNM, a) - ACTNM]; };
+    for (int p = 0; p < nPl; ++p) {
+        RunStat bins[IDXBINS];
+        for (int w = 0; w < nThr; ++w) {
+            for (int b = 0; b < IDXBINS; ++b) bins[b] += gain[(static_cast<size_t>(w) * nPl + p) * IDXBINS + b];
+        }
+        // Weighted least squares of gain against count, weights 1 / SE^2
+        double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        long long n = 0;
+        for (int b = 0; b < IDXBINS; ++b) {
+            n += bins[b].n;
+            double se = bins[b].sem();
+            if (bins[b].n < IDXMIN || se <= 0) continue;
+            double wt = 1.0 / (se * se), x = b + IDXLO + 0.5; // Bin centre
+            sw += wt;
+            sx += wt * x;
+            sy += wt * bins[b].mean;
+            sxx += wt * x * x;
+            sxy += wt * x * bins[b].mean;
+        }
+        double det = sw * sxx - sx * sx;
+        const IdxPlay& ip = plays[p];
+        std::string hand = std::to_string(ip.tot) + " v " + (ip.up == 1 ? std::string("A") : std::to_string(ip.up));
+        std::string play = std::string(actNm(ip.dev)) + "/" + actNm(ip.base);
+        std::cout << std::left << std::setw(10) << hand << std::setw(14) << play;
+        if (det <= 0) {
+            std::cout << std::setw(12) << "-" << std::right << std::setw(10) << n << std::setw(12) << "-" << "\n";
+            continue;
+        }
+        double slope = (sw * sxy - sx * sy) / det;
+        double icpt = (sy - slope * sx) / sw;
+        double idx = -icpt / slope; // Count where the deviation breaks even
+        std::ostringstream ix; // Deviate at or above a rising line's index, at or below a falling one's
+        ix << (slope > 0 ? ">= " : "<= ") << std::showpos << std::lround(idx);
+        std::cout << std::setw(12) << ix.str() << std::right << std::setw(10) << n << std::setprecision(4)
+                  << std::setw(12) << slope << std::setprecision(0) << "\n";
+    }
+    std::cout << std::setprecision(2) << "Time: " << secs << " s (" << std::setprecision(0)
+              << (secs > 0 ? (nRun + forks) / secs : 0) << " rounds/sec, " << forks << " copied)\n";
+}
+
+// Runs the index search with the compiled rule set when one was chosen
+void runIdx(const RunOpts& opt) {
+    switch (opt.preset) {
+        case 0: idxSrchR(opt, RulStd()); break;
+        case 1: idxSrchR(opt, RulVegas()); break;
+        case 2: idxSrchR(opt, RulEuro()); break;
+        default: idxSrchR(opt, opt.rules); break;
+    }
+}
+
+// Suit letters for text exports
+const char SUITLTR[NSUITS] = {'S', 'H', 'D', 'C'};
+
+// Event Log CSV Exporter
+// Converts a binary event log into one CSV line per record
+void expCsv(const std::string& inPath, const std::string& outPath) {
+    std::ifstream in(inPath, std::ios::binary); // Binary event log
+    if (!in) throw std::runtime_error("Cannot open event log " + inPath);
+    EvtRec hdr; // File header
+    if (!in.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) || std::memcmp(&hdr, EVMAGIC, sizeof(EVMAGIC)) != 0) {
+        throw std::runtime_error(inPath + " is not a Blackjack event log");
+    }
+    if (hdr.amt != static_cast<int32_t>(EVVERS)) {
+        throw std::runtime_error(inPath + " has an unsupported event log version");
+    }
+    std::ofstream out(outPath); // CSV output
+    if (!out) throw std::runtime_error("Cannot open " + outPath);
+
+    out << "table,round,event,seat,hand,value,score,amount\n";
+    std::vector<EvtRec> blk(EVBLK); // Read buffer
+    long long nRec = 0; // Records exported
+    while (in) {
+        in.read(reinterpret_cast<char*>(blk.data()), blk.size() * sizeof(EvtRec));
+        size_t got = static_cast<size_t>(in.gcount()) / sizeof(EvtRec); // Whole records read
+        for (size_t i = 0; i < got; ++i) {
+            const EvtRec& r = blk[i];
+            out << r.tbl << ',' << r.rnd << ',';
+            switch (r.type) {
+                case EV_DEAL: {
+                    Card c; // Decode the card for display
+                    c.code = r.val;
+                    out << "deal," << int(r.seat) << ',' << int(r.hand) << ',' << RNKSTR[c.rank()] << SUITLTR[c.suit()];
+                    break;
+                }
+                case EV_ACT: out << "action," << int(r.seat) << ',' << int(r.hand) << ',' << char(r.val); break;
+                case EV_SETL: out << "settle," << int(r.seat) << ',' << int(r.hand) << ',' << char(r.val); break;
+                case EV_SHUF: out << "reshuffle,,," << (r.val ? "mid-round" : "round-start"); break;
+                default: out << "unknown," << int(r.seat) << ',' << int(r.hand) << ',' << int(r.val); break;
             }
+            out << ',' << int(r.score) << ',' << r.amt << '\n';
         }
-        // Set up player's initial hand and deduct chips
-        p.hands.emplace_back(); // Add initial hand
-        p.hands.front().bet = betAmt; // Set bet for the hand
-        p.chips -= betAmt; // Deduct bet from chips
-        playQue.push(&p); // Add player to the turn order queue
-    });
-    
-    // Initial Deal (Player, Dealer, Player, Dealer)
-    std::cout << "\n--- Initial Deal ---\n";
-    // Deal card 1 to all players (in order)
-    std::queue<Player*> tempQ = playQue; // Copy queue for iteration
-    while (!tempQ.empty()) { // While queue not empty
-        dealCrd(tempQ.front()->hands.front().cards); // Deal to player's first hand
-        tempQ.pop(); // Remove from temp queue
-    }
-    // Deal card 1 to dealer
-    dealCrd(dealr.hands.front().cards);
-    
-    // Deal card 2 to all players
-    tempQ = playQue;
-    while (!tempQ.empty()) { // While queue not empty
-        dealCrd(tempQ.front()->hands.front().cards); // Deal to player's first hand
-        tempQ.pop(); // Remove from temp queue
-    }
-    // Deal card 2 to dealer
-    dealCrd(dealr.hands.front().cards); // Dealer's hole card
-
-    // Display initial hands
-    std::cout << "\nDealer's upcard: ";
-    prntHnd(dealr.hands.front(), true); // Hide the second card
-    std::cout << "\n";
-    
-    // Check for naturals
-    Hand& dealrH = dealr.hands.front(); // Dealer's hand
-    bool dealrNat = is_nat(dealrH); // Check if dealer has natural
+        nRec += static_cast<long long>(got);
+    }
+    std::cout << "Exported " << nRec << " events to " << outPath << "\n";
+}
 
-    if (dealrNat) {
-        std::cout << "\n**DEALER NATURAL BLACKJACK!**\n";
+// Mapped File
+// Read-only view of a whole file. With mmap only the pages touched are
+// read, so looking up one round of a huge replay costs a few page faults.
+struct MapFile {
+    const uint8_t* p = nullptr; // File contents
+    size_t n = 0; // File size
+#if BJMMAP
+    int fd = -1;
+
+    explicit MapFile(const std::string& path) {
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat sb;
+        if (fd < 0 || ::fstat(fd, &sb) != 0) throw std::runtime_error("Cannot open " + path);
+        n = static_cast<size_t>(sb.st_size);
+        if (n == 0) return;
+        void* m = ::mmap(nullptr, n, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map " + path);
+        }
+        p = static_cast<const uint8_t*>(m);
     }
+    ~MapFile() {
+        if (p) ::munmap(const_cast<uint8_t*>(p), n);
+        if (fd >= 0) ::close(fd);
+    }
+#else
+    std::vector<uint8_t> data; // Whole file, read in
 
-    // Player Actions Phase
-    while (!playQue.empty()) { // While there are players to process
-        Player* p = playQue.front(); // Queue: front()
-        playQue.pop(); // Queue: pop()
-        
-        // If dealer has natural, only check for push, otherwise players play
-        if (!dealrNat) {
-            hdlPlay(*p, dealrH);
-        } else {
-            std::cout << "\n" << p->name << ": Dealer has a Natural. Skip action phase.\n";
+    explicit MapFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Cannot open " + path);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        p = data.data();
+        n = data.size();
+    }
+#endif
+    MapFile(const MapFile&) = delete;
+    MapFile& operator=(const MapFile&) = delete;
+};
+
+// Replay Strategy
+// Answers with a recorded round's bets and decisions, in order
+struct RpStrat : Strat {
+    const RpSeat* seats = nullptr; // Recorded seats
+    int nSeat = 0;
+    const uint8_t* acts = nullptr; // Recorded decisions
+    int nAct = 0;
+    int nBet = 0; // Bets given so far
+    int nUsed = 0; // Decisions given so far
+    bool over = false; // The round asked for more than was recorded
+
+    int getBet(const Player& p) override {
+        if (nBet < nSeat) return seats[nBet++].bet;
+        over = true;
+        return 1;
+    }
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override {
+        if (nUsed < nAct) return static_cast<char>(acts[nUsed++]);
+        over = true;
+        return 'S';
+    }
+};
+
+// Checks that the record at off lies inside the file and holds only
+// values playRnd can be given: seat count, chips and bets within the
+// recorder's limits (maxBet from rpMaxBet), card codes and decisions.
+// Nothing else in a record is read before this passes.
+bool rpSound(const MapFile& dat, uint64_t off, int32_t maxBet) {
+    if (off < sizeof(RpHdr) || off > dat.n || dat.n - off < sizeof(RpRnd)) return false;
+    const uint8_t* rec = dat.p + off;
+    RpRnd rr;
+    std::memcpy(&rr, rec, sizeof(rr));
+    if (rr.nSeat < 1 || rr.nSeat > MAXSEAT || rr.nCrd > MAXDK * DKSIZE) return false;
+    size_t len = sizeof(rr) + rr.nSeat * sizeof(RpSeat) + rr.nCrd + rr.nAct; // Whole record
+    if (dat.n - off < len) return false;
+    for (int i = 0; i < rr.nSeat; ++i) {
+        RpSeat s;
+        std::memcpy(&s, rec + sizeof(rr) + i * sizeof(RpSeat), sizeof(s));
+        if (s.chips > RPMAXCHP || s.bet < 1 || s.bet > s.chips || s.bet > maxBet) return false;
+    }
+    const uint8_t* crds = rec + sizeof(rr) + rr.nSeat * sizeof(RpSeat);
+    for (int i = 0; i < rr.nCrd; ++i) {
+        if (crds[i] >= DKSIZE) return false;
+    }
+    for (int i = 0; i < rr.nAct; ++i) {
+        if (crds[rr.nCrd + i] == 0 || !std::strchr(RPACTS, crds[rr.nCrd + i])) return false;
+    }
+    return true;
+}
+
+// Re-deals one recorded round through playRnd and checks that it used
+// exactly the recorded cards and decisions and settled every seat for the
+// recorded net. The shoe is loaded with the round's cards in dealing
+// order, padded past the cut card so no reshuffle intervenes. The record
+// must have passed rpSound.
+template <bool Loud, class R>
+bool vfyRnd(const uint8_t* rec, Table& tbl, const R& rul) {
+    RpRnd rr;
+    std::memcpy(&rr, rec, sizeof(rr));
+    std::vector<RpSeat> seats(rr.nSeat);
+    std::memcpy(seats.data(), rec + sizeof(rr), rr.nSeat * sizeof(RpSeat));
+    const uint8_t* crds = rec + sizeof(rr) + rr.nSeat * sizeof(RpSeat);
+
+    tbl.deck.clear();
+    for (int i = 0; i < rr.nCrd; ++i) {
+        Card c;
+        c.code = crds[i];
+        tbl.deck.push(c);
+    }
+    while (tbl.deck.size() <= rul.cut && tbl.deck.len < MAXDK * DKSIZE) tbl.deck.push(Card(0, 0)); // Never dealt
+    tbl.cnt.reset(rul.decks);
+    PlyrReg plyrs(rr.nSeat);
+    for (const RpSeat& s : seats) plyrs.add("Seat " + std::to_string(s.id), s.chips);
+    Player dealr = {0, "Dealer", 0};
+    dealr.hands.emplace_back();
+    RpStrat strat;
+    strat.seats = seats.data();
+    strat.nSeat = rr.nSeat;
+    strat.acts = crds + rr.nCrd;
+    strat.nAct = rr.nAct;
+    playRnd<Loud>(tbl, plyrs, dealr, strat, rul);
+
+    bool ok = !strat.over && strat.nBet == rr.nSeat && strat.nUsed == rr.nAct && tbl.deck.pos == rr.nCrd;
+    for (int i = 0; i < rr.nSeat; ++i) {
+        int64_t got = static_cast<int64_t>(plyrs.nth(i).chips) - seats[i].chips; // Re-settled net
+        if (got != seats[i].net) {
+            ok = false;
+            if (Loud) std::cout << "Seat " << seats[i].id << ": recorded net " << seats[i].net << ", replayed " << got << "\n";
         }
     }
-    
-    // Dealer Play
-    std::cout << "\n" << std::string(50, '-') << "\n";
-    std::cout << "               DEALER'S PLAY\n";
-    std::cout << std::string(50, '-') << "\n";
-    
-    int d_score = calcScr(dealrH); // Dealer's initial score
-    std::cout << "Dealer reveals hole card. Full Hand (" << d_score << "): ";
-    prntHnd(dealrH); // Print dealer's full hand
-    std::cout << "\n";
-
-    if (!dealrNat) { // Only play if dealer doesn't have natural
-        while (d_score < 17) { // Dealer hits on soft 17
-            std::cout << "Dealer Hits (score < 17).\n";
-            dealCrd(dealrH.cards); // Deal card to dealer
-            d_score = calcScr(dealrH); // Recalculate score
-            std::cout << "Dealer's Hand (" << d_score << "): ";
-            prntHnd(dealrH); // Print dealer's hand
-            std::cout << "\n";
+    return ok;
+}
+
+// Verifies round rnd (1-based, in file order) of a replay file, or every
+// round when rnd is 0
+template <class R>
+void vfyR(const MapFile& dat, const MapFile& idx, long long rnd, const R& rul) {
+    long long nRec = static_cast<long long>(idx.n / sizeof(uint64_t));
+    std::unique_ptr<Table> tbl(new Table); // Shoe reused for every round
+    const int32_t maxBet = rpMaxBet(rul.bjNum);
+    auto recAt = [&](long long i) -> const uint8_t* { // Round i's record, or null if it is damaged
+        uint64_t off;
+        std::memcpy(&off, idx.p + i * sizeof(off), sizeof(off));
+        return rpSound(dat, off, maxBet) ? dat.p + off : nullptr;
+    };
+    if (rnd > 0) {
+        if (rnd > nRec) throw std::runtime_error("Replay has only " + std::to_string(nRec) + " rounds");
+        const uint8_t* rec = recAt(rnd - 1);
+        if (!rec) throw std::runtime_error("Replay round " + std::to_string(rnd) + " is damaged");
+        RpRnd rr;
+        std::memcpy(&rr, rec, sizeof(rr));
+        std::cout << "### Verify: round " << rnd << " of " << nRec << " (table " << rr.tbl << ", round " << rr.rnd
+                  << ", shoe at card " << rr.pos << ") ###\n";
+        bool ok = vfyRnd<true>(rec, *tbl, rul);
+        std::cout << (ok ? "\nSettlement matches the recording.\n" : "\nSettlement DIFFERS from the recording.\n");
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    long long bad = 0; // Rounds that settle differently
+    long long dmg = 0; // Rounds that cannot be replayed
+    for (long long i = 0; i < nRec; ++i) {
+        const uint8_t* rec = recAt(i);
+        if (!rec) {
+            if (++dmg + bad <= 10) std::cout << "Round " << i + 1 << " is damaged\n";
+            continue;
         }
-        std::cout << "Dealer Stands at " << d_score << ".\n";
+        if (vfyRnd<false>(rec, *tbl, rul)) continue;
+        if (++bad + dmg <= 10) std::cout << "Round " << i + 1 << " differs from the recording\n";
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Verified " << nRec << " rounds: " << bad << " differ, " << dmg << " damaged\n";
+    std::cout << std::setprecision(2) << "Time: " << secs << " s (" << std::setprecision(0)
+              << (secs > 0 ? nRec / secs : 0) << " rounds/sec)\n";
+}
+
+// Opens a replay file and its index and verifies it with the rules it was
+// recorded under
+void runVfy(const RunOpts& opt) {
+    MapFile dat(opt.vfyPath);
+    MapFile idx(opt.vfyPath + ".idx");
+    RpHdr hdr;
+    if (dat.n < sizeof(hdr)) throw std::runtime_error(opt.vfyPath + " is not a replay file");
+    std::memcpy(&hdr, dat.p, sizeof(hdr));
+    if (std::memcmp(hdr.magic, RPMAGIC, sizeof(RPMAGIC)) != 0 || hdr.vers != RPVERS) {
+        throw std::runtime_error(opt.vfyPath + " is not a replay file of this version");
     }
+    RuleSet rs;
+    rs.decks = hdr.rul[0];
+    rs.cut = hdr.rul[1];
+    rs.h17 = hdr.rul[2];
+    rs.bjNum = hdr.rul[3];
+    rs.bjDen = hdr.rul[4];
+    rs.das = hdr.rul[5];
+    rs.spltHnds = hdr.rul[6];
+    rs.surr = hdr.rul[7];
+    rs.enhc = hdr.rul[8];
+    chkRules(rs);
+    std::cout << "Replay: seed " << hdr.seed << ", rules " << (hdr.preset >= 0 ? RULNM[hdr.preset] : "custom") << " ("
+              << rulDesc(rs) << ")\n";
+    switch (hdr.preset) {
+        case 0: vfyR(dat, idx, opt.vfyRnd, RulStd()); break;
+        case 1: vfyR(dat, idx, opt.vfyRnd, RulVegas()); break;
+        case 2: vfyR(dat, idx, opt.vfyRnd, RulEuro()); break;
+        default: vfyR(dat, idx, opt.vfyRnd, rs); break;
+    }
+}
 
-    // Final Settlement Phase
-    std::cout << "\n" << std::string(50, '-') << "\n";
-    std::cout << "               FINAL SETTLEMENT\n";
-    std::cout << std::string(50, '-') << "\n";
+// Game Server
+// --serve PORT hosts tables for players who connect over TCP and speak a
+// line-based text protocol. Each of T worker threads runs its own epoll
+// loop on its own listening socket (SO_REUSEPORT spreads connections
+// across them) and owns every table its connections sit at, so no table
+// is ever shared between threads. Tables never block a worker: NetStrat
+// answers a bet or decision that has not arrived yet with 0, stepRnd
+// returns, and the round resumes from its RndSt when the player's line
+// comes in. A table costs its Table and RndSt, not a thread or a stack.
+//
+// Protocol, one message per line:
+//   server: WELCOME <table> <seat> <chips>
+//   server: BET? <chips>                        client: BET <n>
+//   server: ACT? <cards> <score> <upcard> <opts> client: H | S | D | P | R
+//   server: RESULT <net> <chips>
+//   server: ERR <reason>, BYE <reason>          client: QUIT
+// Players who join mid-round are dealt in from the next round. A player
+// who disconnects mid-round bets 1 and stands on every remaining hand.
+// Once a table's seats and buffers have warmed up, a round allocates
+// nothing: hands are inline in Player, player slots are preallocated in
+// the table's PlyrReg, and prompts are formatted into one reused line
+// buffer and appended to each connection's reused output buffer.
 
-    // STL Algorithm: std::for_each to iterate over all players
-    std::for_each(plyrs.begin(), plyrs.end(), [&](Player& p) {
-        // Iterator: Iterate over all hands a player might have (original + split hands)
-        for (auto& hand : p.hands) { // For each hand
-            if (hand.bet > 0) { // Only settle hands that were bet on
-                setHnd(p, hand, dealrH); // Settle the hand
-            } else {
-                discHnd(hand); // Clean up empty hands if any somehow remain
+const int SRVSEATS = 7; // Seats per network table
+const int SRVBANK = 1000; // Chips each network player starts with
+const size_t SRVLINE = 256; // Longest pending line a client may send; longer ones close the connection
+
+#if BJNET
+struct SrvWrk;
+
+// Appends an integer to s without a temporary string
+inline std::string& appInt(std::string& s, long long v) {
+    char buf[24]; // Enough for any 64-bit value
+    std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+    return s.append(buf, r.ptr);
+}
+
+// Appends a card as rank and suit letter, e.g. "10H"
+inline std::string& appCrd(std::string& s, const Card& c) {
+    return s.append(RNKSTR[c.rank()]).append(1, SUITLTR[c.suit()]);
+}
+
+// Network Seat
+struct SrvSeat {
+    int fd = -1; // Player's connection, -1 once they have left
+    char want = 0; // Request sent and unanswered: 'B'et or 'A'ction
+    int bet = 0; // Bet received, 0 while waiting
+    char act = 0; // Decision received, 0 while waiting
+    int chips0 = 0; // Chips when the round started, for RESULT
+};
+
+// Network Strategy
+// Turns stepRnd's requests into prompts and hands back the replies
+struct NetStrat : Strat {
+    SrvWrk& wrk; // Worker that owns the connections
+    SrvSeat* seats; // The table's seats, indexed by player id
+
+    NetStrat(SrvWrk& w, SrvSeat* st) : wrk(w), seats(st) {}
+    int getBet(const Player& p) override;
+    char getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                bool canSurr) override;
+};
+
+// Network Table
+struct SrvTbl {
+    int id; // Index within the worker
+    Table tbl; // Shoe, count and stream
+    PlyrReg plyrs{SRVSEATS}; // Players by seat; arrivals wait to be dealt in
+    Player dealr = {0, "Dealer", 0};
+    SrvSeat seats[SRVSEATS + 1]; // Seat data by player id (0 is the dealer)
+    NetStrat strat; // Prompts this table's players
+    RndSt st; // The round in progress
+    bool live = false; // A round is in progress
+
+    SrvTbl(SrvWrk& w, int i) : id(i), strat(w, seats) { dealr.hands.emplace_back(); }
+};
+
+// Network Connection
+struct SrvConn {
+    int tbl = 0; // Table index
+    int seat = 0; // Seat (player id) at that table
+    std::string in; // Bytes received, up to an incomplete line
+    std::string out; // Bytes waiting for the socket to take them
+};
+
+// Server Worker
+// One thread's epoll loop with its connections and tables
+struct SrvWrk {
+    int idx; // Worker number
+    int epfd = -1; // epoll instance
+    int lfd = -1; // Listening socket
+    Rng strm; // Stream the next table takes (jumped after each table)
+    ShufPool* shuf = nullptr; // Prepares every table's next reshuffle
+    ShufAlg alg = ShufAlg::FY; // Shuffle for new tables
+    const TagSys* tags = &TAGSYS[0]; // Tag system for new tables
+    std::unordered_map<int, SrvConn> conns; // Connections by descriptor
+    std::vector<std::unique_ptr<SrvTbl>> tbls; // Tables, never moved once created
+    std::vector<int> open; // Tables that have had a seat freed
+    std::string msg; // Line being formatted; keeps its capacity between messages
+
+    // Starts a message in msg
+    std::string& line(const char* txt) {
+        msg.assign(txt);
+        return msg;
+    }
+
+    // Queues a line for a connection and writes as much as the socket takes
+    void send(int fd, const std::string& line) {
+        if (fd < 0) return; // Player has left
+        SrvConn& c = conns.at(fd);
+        bool idle = c.out.empty();
+        c.out += line;
+        c.out += '\n';
+        if (idle) flush(fd, c);
+    }
+
+    // Writes pending output; waits for EPOLLOUT while the socket is full
+    void flush(int fd, SrvConn& c) {
+        while (!c.out.empty()) {
+            ssize_t n = ::send(fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                return; // The read side sees the error and drops the connection
             }
+            c.out.erase(0, static_cast<size_t>(n));
         }
-        // Cleanup: Use std::list::remove_if to clean up all empty hands
-        p.hands.remove_if([](const Hand& h){ // Lambda to check if hand is empty
-            return h.cards.empty(); // Remove if empty
-        });
-    });
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP | (c.out.empty() ? 0u : static_cast<uint32_t>(EPOLLOUT));
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+
+    // Closes a connection; its seat is freed once its player leaves the table
+    void drop(int fd) {
+        auto it = conns.find(fd);
+        if (it == conns.end()) return;
+        SrvTbl& t = *tbls[it->second.tbl];
+        t.seats[it->second.seat].fd = -1;
+        conns.erase(it);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+    }
+};
 
-    // Discard dealer's hand
-    discHnd(dealrH);
+int NetStrat::getBet(const Player& p) {
+    SrvSeat& s = seats[p.id];
+    if (s.fd < 0) return 1; // Left mid-round: smallest bet
+    if (s.want == 'B' && s.bet > 0) {
+        int bet = s.bet;
+        s.bet = 0;
+        s.want = 0;
+        if (bet <= p.chips) return bet;
+        wrk.send(s.fd, appInt(wrk.line("ERR bet must be between 1 and "), p.chips));
+    }
+    if (s.want != 'B') { // Prompt once per request
+        s.want = 'B';
+        wrk.send(s.fd, appInt(wrk.line("BET? "), p.chips));
+    }
+    return 0; // Not yet
 }
 
-// Main Game Loop
-void runGame() {
-    std::list<Player> plyrs; // List of players
-    Player dealr = {0, "Dealer", 0}; // Dealer player
-    dealr.hands.emplace_back(); // Dealer always has one hand
+char NetStrat::getAct(const Player& p, const Hand& hand, const Card& upCrd, bool canSplt, bool canDbl,
+                      bool canSurr) {
+    SrvSeat& s = seats[p.id];
+    if (s.fd < 0) return 'S'; // Left mid-round: stand
+    if (s.want == 'A' && s.act != 0) {
+        char act = s.act;
+        s.act = 0;
+        s.want = 0;
+        return act; // hdlPlay asks again if it is not allowed
+    }
+    if (s.want != 'A') {
+        s.want = 'A';
+        std::string& out = wrk.line("ACT? ");
+        for (int i = 0; i < hand.cards.size(); ++i) {
+            if (i) out += ',';
+            appCrd(out, hand.cards[i]);
+        }
+        appInt(out += ' ', calcScr(hand)) += ' ';
+        appCrd(out, upCrd) += " HS";
+        if (canDbl) out += 'D';
+        if (canSplt) out += 'P';
+        if (canSurr) out += 'R';
+        wrk.send(s.fd, out);
+    }
+    return 0;
+}
 
-    std::cout << "### Welcome to Blackjack Casino ###\n";
-    
-    // Setup Players
-    int numPlay = 0; // Number of players input
-    while (numPlay < 1 || numPlay > 3) {
-        std::cout << "Enter number of players (1-3): ";
-        std::cin >> numPlay; // Input number of players
-        clear_in();
+// Between rounds: drops players who left or went broke, deals in new
+// arrivals and records everyone's chips for the round's RESULT
+void srvAdmit(SrvWrk& w, SrvTbl& t) {
+    t.plyrs.dropIf([&](const Player& p) {
+        SrvSeat& s = t.seats[p.id];
+        if (s.fd >= 0 && p.chips < 1) {
+            w.send(s.fd, "BYE out of chips");
+            w.drop(s.fd);
+        }
+        if (s.fd >= 0) return false;
+        w.open.push_back(t.id); // Seat free again
+        return true;
+    });
+    for (int id = 1; id <= SRVSEATS; ++id) {
+        if (t.plyrs.stat[id] != PS_WAIT) continue;
+        if (t.seats[id].fd < 0) { // Left before being dealt in
+            t.plyrs.remove(id);
+            w.open.push_back(t.id);
+        } else {
+            t.plyrs.seat(id);
+        }
     }
+    for (auto& p : t.plyrs) {
+        SrvSeat& s = t.seats[p.id];
+        s.chips0 = p.chips;
+        s.want = 0;
+        s.bet = 0;
+        s.act = 0;
+    }
+}
 
-    for (int i = 1; i <= numPlay; ++i) { // Get player names
-        std::string name; // Player name input
-        std::cout << "Enter name for Player " << i << ": ";
-        std::getline(std::cin, name); // Input player name
-        plyrs.emplace_back(Player{i, name, 1000}); // Add player to list
+// Runs a table's rounds until one waits on a player (or nobody is seated)
+template <class R>
+void srvPump(SrvWrk& w, SrvTbl& t, const R& rul) {
+    for (;;) {
+        if (!t.live) { // Start the next round
+            srvAdmit(w, t);
+            if (t.plyrs.empty()) return;
+            t.st = RndSt();
+            t.live = true;
+        }
+        if (!stepRnd<false>(t.tbl, t.plyrs, t.dealr, t.strat, rul, t.st)) return; // Suspended
+        t.live = false;
+        for (const auto& p : t.plyrs) {
+            const SrvSeat& s = t.seats[p.id];
+            std::string& out = appInt(w.line("RESULT "), p.chips - s.chips0);
+            w.send(s.fd, appInt(out += ' ', p.chips));
+        }
     }
+}
 
-    // Initial Deck Setup
-    createDk(4); // Create deck with 4 standard decks
-    shufDk(); // Shuffle the deck
+// Seats a new connection at a table with room, opening a table if none has
+template <class R>
+void srvSeat(SrvWrk& w, int fd, const R& rul) {
+    SrvTbl* t = nullptr;
+    while (!w.open.empty() && !t) { // Reuse a table with a freed seat
+        SrvTbl& c = *w.tbls[w.open.back()];
+        if (c.plyrs.nReg < SRVSEATS) t = &c;
+        else w.open.pop_back();
+    }
+    if (!t && !w.tbls.empty() && w.tbls.back()->plyrs.nReg < SRVSEATS) t = w.tbls.back().get();
+    if (!t) { // Every table is full
+        w.tbls.emplace_back(new SrvTbl(w, static_cast<int>(w.tbls.size())));
+        t = w.tbls.back().get();
+        t->tbl.rng = w.strm;
+        t->tbl.shufAlg = w.alg;
+        t->tbl.cnt.sys = w.tags;
+        w.strm.jump(); // Next table's stream
+        w.shuf->join(t->tbl); // Reshuffles never stall a live round
+        createDk(t->tbl, rul.decks);
+        shufDk(t->tbl);
+    }
+    int id = t->plyrs.add("", SRVBANK, false); // Waits for the next round
+    t->plyrs[id].name = appInt(w.line("Seat "), id);
+    SrvSeat& s = t->seats[id];
+    s = SrvSeat();
+    s.fd = fd;
+    SrvConn& c = w.conns[fd];
+    c.tbl = t->id;
+    c.seat = id;
+    std::string& out = appInt(w.line("WELCOME "), w.idx);
+    appInt(out += '-', t->id);
+    appInt(out += ' ', id);
+    w.send(fd, appInt(out += ' ', SRVBANK));
+    srvPump(w, *t, rul); // Deals them in if the table is between rounds
+}
 
-    // Play Again Loop
-    std::string playAgn = "Y";
+// Applies one line from a connection; returns false if it should close
+bool srvLine(SrvWrk& w, SrvConn& c, const std::string& line) {
+    SrvSeat& s = w.tbls[c.tbl]->seats[c.seat];
+    if (line == "QUIT") return false;
+    if (line.compare(0, 4, "BET ") == 0) {
+        int bet = std::atoi(line.c_str() + 4);
+        if (s.want != 'B') return true; // Not asked: ignored
+        if (bet < 1) {
+            w.send(s.fd, "ERR bet must be a positive number");
+            return true;
+        }
+        s.bet = bet;
+    } else if (line.size() == 1 && std::strchr("HSDPR", line[0])) {
+        if (s.want == 'A') s.act = line[0];
+    } else if (!line.empty()) {
+        w.send(s.fd, "ERR unknown command");
+    }
+    return true;
+}
 
-    while (playAgn == "Y") { // While player wants to play again
-        try {
-            // Check for players who are out of money
-            // STL Algorithm: std::remove_if (using lambda) to manage player list
-            plyrs.remove_if([&](const Player& p) { // Lambda to check if player is out of chips
-                if (p.chips < 1) { // If player has no chips
-                    std::cout << "\n" << p.name << " is out of chips and leaves the game.\n";
-                    return true;
+// Worker thread: accepts, reads and writes connections and pumps their
+// tables, all without blocking on any one player
+template <class R>
+void srvLoop(SrvWrk& w, int port, const R& rul) {
+    w.epfd = epoll_create1(0);
+    w.lfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (w.epfd < 0 || w.lfd < 0) throw std::runtime_error("Cannot create server sockets");
+    int one = 1;
+    setsockopt(w.lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(w.lfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)); // Every worker listens on the port
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(w.lfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(w.lfd, SOMAXCONN) < 0) {
+        throw std::runtime_error("Cannot listen on port " + std::to_string(port));
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = w.lfd;
+    epoll_ctl(w.epfd, EPOLL_CTL_ADD, w.lfd, &ev);
+
+    const int MAXEV = 256; // Events handled per wakeup
+    epoll_event evs[MAXEV];
+    char buf[4096]; // Read buffer
+    for (;;) {
+        int n = epoll_wait(w.epfd, evs, MAXEV, -1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) throw std::runtime_error("epoll_wait failed");
+        for (int e = 0; e < n; ++e) {
+            int fd = evs[e].data.fd;
+            if (fd == w.lfd) { // New players
+                int cfd;
+                while ((cfd = accept4(w.lfd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+                    setsockopt(cfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Prompts are small
+                    epoll_event cev = {};
+                    cev.events = EPOLLIN | EPOLLRDHUP;
+                    cev.data.fd = cfd;
+                    epoll_ctl(w.epfd, EPOLL_CTL_ADD, cfd, &cev);
+                    srvSeat(w, cfd, rul);
                 }
-                return false; // Keep player otherwise
-            });
-            
-            // Check if any players remain
-            if (plyrs.empty()) { // No players left
-                std::cout << "\nAll players are out of chips. Game Over.\n";
-                break;
+                continue;
             }
-            
-            // Check if dealer's hand needs reset
-            if (!dealr.hands.empty() && dealr.hands.front().bet > 0) { // If dealer's hand has cards
-                 discHnd(dealr.hands.front()); // Discard dealer's hand
-            } else if (dealr.hands.empty()) { // If dealer has no hands
-                dealr.hands.emplace_back(); // Create dealer's hand
+            auto it = w.conns.find(fd);
+            if (it == w.conns.end()) continue; // Closed earlier in this batch
+            SrvConn& c = it->second;
+            int tbl = c.tbl;
+            if (evs[e].events & EPOLLOUT) w.flush(fd, c);
+            bool keep = !(evs[e].events & EPOLLERR);
+            bool eof = false; // Peer closed or failed; lines already sent still count
+            if (keep && (evs[e].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))) {
+                while (keep) { // Drain the socket, applying lines as they complete
+                    ssize_t got = ::recv(fd, buf, sizeof(buf), 0);
+                    if (got <= 0) {
+                        eof = got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+                        break;
+                    }
+                    c.in.append(buf, static_cast<size_t>(got));
+                    size_t beg = 0, eol;
+                    while (keep && (eol = c.in.find('\n', beg)) != std::string::npos) { // Complete lines
+                        std::string line = c.in.substr(beg, eol - beg);
+                        if (!line.empty() && line.back() == '\r') line.pop_back();
+                        keep = srvLine(w, c, line);
+                        beg = eol + 1;
+                    }
+                    c.in.erase(0, beg);
+                    if (keep && c.in.size() > SRVLINE) { // No protocol line is this long
+                        w.send(fd, "ERR line too long");
+                        keep = false;
+                    }
+                }
             }
+            if (!keep || eof) w.drop(fd);
+            srvPump(w, *w.tbls[tbl], rul); // Resume the table with what arrived
+        }
+    }
+}
 
-            // Play a round of Blackjack
-            playRnd(plyrs, dealr);
+// Starts one worker per thread; each table's streams come from the run
+// seed, with worker w long-jumped w times so workers never overlap
+template <class R>
+void runSrvR(const RunOpts& opt, const R& rul) {
+    std::cout << "Serving Blackjack on port " << opt.port << " with " << opt.thrds << " threads ("
+              << rulDesc(toRules(rul)) << ")\n" << std::flush;
+    ShufPool shuf; // One shuffler serves every worker's tables
+    std::vector<std::thread> pool;
+    Rng strm(opt.seed);
+    for (int t = 0; t < opt.thrds; ++t) {
+        pool.emplace_back([&opt, &rul, &shuf, strm, t]() {
+            SrvWrk w;
+            w.idx = t;
+            w.strm = strm;
+            w.shuf = &shuf;
+            w.alg = opt.shufAlg;
+            w.tags = &TAGSYS[static_cast<int>(opt.cntSys)];
+            try {
+                srvLoop(w, opt.port, rul);
+            } catch (const std::exception& e) {
+                std::cerr << "Server worker " << t << ": " << e.what() << "\n";
+            }
+        });
+        strm.longJump();
+    }
+    for (auto& th : pool) th.join();
+}
+#endif
 
-        } catch (const std::exception& e) { // Catch any critical errors
-            std::cerr << "CRITICAL GAME ERROR: " << e.what() << "\n";
-            break;
+// Runs the game server with the run's rule set
+void runSrv(const RunOpts& opt) {
+#if BJNET
+    switch (opt.preset) {
+        case 0: runSrvR(opt, RulStd()); break;
+        case 1: runSrvR(opt, RulVegas()); break;
+        case 2: runSrvR(opt, RulEuro()); break;
+        default: runSrvR(opt, opt.rules); break;
+    }
+#else
+    throw std::runtime_error("--serve needs Linux (epoll)");
+#endif
+}
+
+// Benchmark Result
+struct BchRes {
+    double nsOp = 0.0; // Nanoseconds per operation
+    long long iters = 0; // Operations timed
+    double allocOp = 0.0; // Heap allocations per operation
+    double itemSec = 0.0; // Items (e.g. hands) per second, 0 if not counted
+};
+
+// Times body(n), which runs n operations and returns the items it
+// produced. n doubles until a run takes at least minSec, as in Google
+// Benchmark, and the last run is reported.
+template <class F>
+BchRes runBch(F&& body, double minSec = 0.2) {
+    BchRes res;
+    for (long long n = 1;; n *= 2) {
+        long long a0 = allocCnt();
+        auto start = std::chrono::steady_clock::now();
+        long long items = body(n);
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (secs >= minSec || n >= (1LL << 40)) {
+            res.nsOp = secs * 1e9 / n;
+            res.iters = n;
+            res.allocOp = static_cast<double>(allocCnt() - a0) / n;
+            res.itemSec = items > 0 ? items / secs : 0.0;
+            return res;
         }
+    }
+}
 
-        // Round Summary after each round
-        std::cout << "\n" << std::string(50, '*') << "\n";
-        std::cout << "Round Summary:\n"; // Summarize player chips
+// Engine Benchmark Suite
+// Microbenchmarks for the engine hot paths, one line per case with time
+// per operation, iterations, allocations per operation and, for whole
+// rounds, hands per second. filt keeps only cases whose name contains it.
+void benchAll(const std::string& filt) {
+    volatile long long sink = 0; // Keeps results observable so loops are not removed
+    std::cout << "### Engine Benchmarks ###\n";
+    std::cout << std::left << std::setw(28) << "Benchmark" << std::right << std::setw(14) << "Time"
+              << std::setw(14) << "Iterations" << std::setw(12) << "Allocs/op" << std::setw(16) << "Hands/sec" << "\n";
+    std::cout << std::string(84, '-') << "\n";
 
-        // STL Algorithm: std::for_each to display final chips
-        std::for_each(plyrs.begin(), plyrs.end(), [](const Player& p) {
-            prntStat(p, false); // Print player stats without hands
+    auto report = [&](const std::string& name, auto&& body) {
+        if (name.find(filt) == std::string::npos) return;
+        BchRes r = runBch(body);
+        std::cout << std::left << std::setw(28) << name << std::right << std::setprecision(1)
+                  << std::setw(11) << r.nsOp << " ns" << std::setw(14) << r.iters
+                  << std::setprecision(2) << std::setw(12) << r.allocOp << std::setprecision(0) << std::setw(16);
+        if (r.itemSec > 0) std::cout << r.itemSec;
+        else std::cout << "-";
+        std::cout << "\n";
+    };
 
+    // Deck creation and shuffling, per shoe size and algorithm: the 1, 2,
+    // 6 and 8 deck comparison of the two shuffles, plus the default 4
+    const int DKCNTS[] = {1, 2, 4, 6, 8};
+    for (int nDk : DKCNTS) {
+        std::string dk = "/" + std::to_string(nDk) + "dk";
+        std::unique_ptr<Table> tbl(new Table);
+        tbl->rng.seed(12345); // Fixed seed so runs are comparable
+        report("createDk" + dk, [&](long long n) {
+            for (long long i = 0; i < n; ++i) createDk(*tbl, nDk);
+            sink = sink + tbl->deck.size();
+            return 0LL;
         });
+        createDk(*tbl, nDk); // Full shoe for the shuffles even when --filter skipped createDk
+        for (ShufAlg alg : {ShufAlg::FY, ShufAlg::LEGACY}) {
+            tbl->shufAlg = alg;
+            report(std::string("shufDk/") + (alg == ShufAlg::FY ? "fy" : "legacy") + dk, [&](long long n) {
+                for (long long i = 0; i < n; ++i) shufDk(*tbl);
+                sink = sink + tbl->deck.cards[0].code;
+                return 0LL;
+            });
+        }
+    }
 
-        // Prompt to play again or not
-        std::cout << "\n" << std::string(50, '*') << "\n";
-        std::cout << "Play another round? (Y/N): ";
-        std::cin >> playAgn; // Input choice
-        std::transform(playAgn.begin(), playAgn.end(), playAgn.begin(), ::toupper);
-
-        // Clear input buffer
-        clear_in();
+    // Dealing: one card per operation, discarding the hand when it fills,
+    // from a cut-card shoe and from a CSM
+    for (ShufAlg alg : {ShufAlg::FY, ShufAlg::CSM}) {
+        std::unique_ptr<Table> tbl(new Table);
+        tbl->rng.seed(12345);
+        tbl->shufAlg = alg;
+        createDk(*tbl, 4);
+        shufDk(*tbl);
+        Hand h;
+        report(alg == ShufAlg::CSM ? "dealCrd/csm" : "dealCrd", [&](long long n) {
+            for (long long i = 0; i < n; ++i) {
+                if (h.cards.size() >= 10) discHnd(*tbl, h); // Reshuffles happen inside dealCrd
+                dealCrd<false>(*tbl, h);
+            }
+            sink = sink + h.hard;
+            return 0LL;
+        });
+        discHnd(*tbl, h);
+    }
 
+    // Scoring over a spread of prebuilt hands
+    {
+        std::vector<Hand> hands(64);
+        Rng g(7);
+        for (auto& h : hands) {
+            int nCrd = 2 + static_cast<int>(g.below(4));
+            for (int c = 0; c < nCrd; ++c) h.add(Card(static_cast<int>(g.below(NRANKS)), 0));
+        }
+        report("calcScr", [&](long long n) {
+            long long tot = 0;
+            for (long long i = 0; i < n; ++i) tot += calcScr(hands[i & 63]);
+            sink = sink + tot;
+            return 0LL;
+        });
     }
 
-    // If player chooses not to play again or all players are out
-    std::cout << "\nThank you for playing Blackjack. Final Chip Counts:\n";
-    std::for_each(plyrs.begin(), plyrs.end(), [](const Player& p) { // Final stats
-        prntStat(p, false); // Print player stats without hands
-    });
+    // Splitting a pair: the new cards are dealt from the shoe and
+    // returned to it, the pair itself is synthetic
+    {
+        std::unique_ptr<Table> tbl(new Table);
+        tbl->rng.seed(12345);
+        createDk(*tbl, 4);
+        shufDk(*tbl);
+        Player p{1, "Bench", 1000000};
+        report("playSplt", [&](long long n) {
+            for (long long i = 0; i < n; ++i) {
+                p.hands.clear();
+                p.hands.emplace_back();
+                Hand& h = p.hands.front();
+                h.bet = 10;
+                h.add(Card(7, 0));
+                h.add(Card(7, 1));
+                playSplt<false>(*tbl, p, p.hands.begin());
+                for (auto& sh : p.hands) tbl->deck.disc(sh.popCrd()); // Give back the dealt cards
+                p.chips += 10;
+            }
+            sink = sink + p.hands.size();
+            return 0LL;
+        });
+    }
 
-    std::cout << "Goodbye!\n";
+    // Whole headless rounds through playRnd, and through the batch path
+    for (int seats : {1, 7}) {
+        std::unique_ptr<Table> tbl(new Table);
+        tbl->rng.seed(12345);
+        createDk(*tbl, RulStd::decks);
+        shufDk(*tbl);
+        PlyrReg plyrs(seats);
+        for (int i = 1; i <= seats; ++i) plyrs.add("Seat " + std::to_string(i), 1000000);
+        Player dealr = {0, "Dealer", 0};
+        dealr.hands.emplace_back();
+        BasStrat strat;
+        report("playRnd/" + std::to_string(seats) + "seat", [&](long long n) {
+            Tally tly;
+            for (long long i = 0; i < n; ++i) {
+                for (auto& p : plyrs) p.chips = 1000000;
+                playRnd<false>(*tbl, plyrs, dealr, strat, RulStd(), &tly);
+            }
+            return tly.hands;
+        });
+        report("simBat/256tbl/" + std::to_string(seats) + "seat", [&](long long n) {
+            Tally tly;
+            simBat(n, seats, 256, RulStd(), Rng(12345), SimdLvl::AVX2, tly); // n rounds across 256 tables
+            return tly.hands;
+        });
+    }
+    std::cout << std::setprecision(0);
 }
 
 int main (int argc, char** argv) {
-    // Set Random Number Seed Here (System clock used in shuffle_deck)
-    
     // Declare all Variables Here (Done within run_game_loop)
-    
+    RunOpts opt; // Run options
+    bool bench = false; // Run the benchmark instead of a game
+    std::string bchFilt; // Only run benchmarks whose name contains this
+    bool dlrPrb = false; // Print dealer outcome probabilities
+    bool idx = false; // Search for count index plays
+    bool noSync = false; // Unsync the C++ streams from stdio
+    std::string csvIn, csvOut; // Event log to export, and the CSV to write
+    bool custom = false; // An individual rule was changed
+    int pen = -1; // Penetration percent from --pen, or -1
+
+    // Set Random Number Seed Here (System clock unless --seed is given)
+    opt.seed = std::chrono::system_clock::now().time_since_epoch().count();
+    opt.thrds = std::max(1u, std::thread::hardware_concurrency()); // One table per core
+
     // Input or initialize values Here
-    
+    for (int i = 1; i < argc; ++i) { // Parse command-line options
+        std::string arg = argv[i];
+        if (arg == "--simulate" && i + 1 < argc) {
+            opt.rnds = std::atoll(argv[++i]); // Number of rounds
+        } else if (arg == "--players" && i + 1 < argc) {
+            opt.plyrs = std::atoi(argv[++i]); // Number of seats
+        } else if (arg == "--seed" && i + 1 < argc) {
+            opt.seed = std::strtoull(argv[++i], nullptr, 10); // Reproducible run
+        } else if (arg == "--shuffle" && i + 1 < argc) {
+            std::string alg = argv[++i]; // Shuffle algorithm name
+            if (alg == "fy") opt.shufAlg = ShufAlg::FY;
+            else if (alg == "legacy") opt.shufAlg = ShufAlg::LEGACY;
+            else if (alg == "csm") opt.shufAlg = ShufAlg::CSM;
+            else {
+                std::cerr << "--shuffle must be fy, legacy or csm\n";
+                return 1;
+            }
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opt.thrds = std::atoi(argv[++i]); // Parallel tables
+        } else if (arg == "--strategy" && i + 1 < argc) {
+            std::string nm = argv[++i]; // Strategy name
+            if (nm == "basic") opt.kind = StratKind::BASIC;
+            else if (nm == "mimic") opt.kind = StratKind::MIMIC;
+            else if (nm == "ev") opt.kind = StratKind::EV;
+            else if (nm == "count") opt.kind = StratKind::COUNT;
+            else {
+                std::cerr << "--strategy must be basic, mimic, ev or count\n";
+                return 1;
+            }
+        } else if (arg == "--count" && i + 1 < argc) {
+            std::string nm = argv[++i]; // Tag system name
+            auto it = std::find_if(std::begin(TAGSYS), std::end(TAGSYS), [&](const TagSys& t) { return nm == t.name; });
+            if (it == std::end(TAGSYS)) {
+                std::cerr << "--count must be hilo, ko or omega2\n";
+                return 1;
+            }
+            opt.cntSys = static_cast<CntSys>(it - std::begin(TAGSYS));
+        } else if (arg == "--rules" && i + 1 < argc) {
+            std::string nm = argv[++i]; // Preset name
+            if (nm == "standard") opt.rules = toRules(RulStd());
+            else if (nm == "vegas") opt.rules = toRules(RulVegas());
+            else if (nm == "euro") opt.rules = toRules(RulEuro());
+            else {
+                std::cerr << "--rules must be standard, vegas or euro\n";
+                return 1;
+            }
+            opt.preset = static_cast<int>(std::find(std::begin(RULNM), std::end(RULNM), nm) - std::begin(RULNM));
+        } else if (arg == "--decks" && i + 1 < argc) {
+            opt.rules.decks = std::atoi(argv[++i]); // Individual rules make the set custom
+            custom = true;
+        } else if (arg == "--pen" && i + 1 < argc) {
+            pen = std::atoi(argv[++i]); // Penetration percent, applied once decks are known
+            custom = true;
+        } else if (arg == "--h17" || arg == "--s17") {
+            opt.rules.h17 = arg == "--h17";
+            custom = true;
+        } else if (arg == "--bj" && i + 1 < argc) {
+            std::string ratio = argv[++i]; // e.g. 3:2 or 6:5
+            size_t colon = ratio.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "--bj must be a ratio like 3:2\n";
+                return 1;
+            }
+            opt.rules.bjNum = std::atoi(ratio.substr(0, colon).c_str());
+            opt.rules.bjDen = std::atoi(ratio.substr(colon + 1).c_str());
+            custom = true;
+        } else if (arg == "--das" || arg == "--nodas") {
+            opt.rules.das = arg == "--das";
+            custom = true;
+        } else if (arg == "--splits" && i + 1 < argc) {
+            opt.rules.spltHnds = std::atoi(argv[++i]); // Most hands after splitting
+            custom = true;
+        } else if (arg == "--surrender" || arg == "--nosurrender") {
+            opt.rules.surr = arg == "--surrender";
+            custom = true;
+        } else if (arg == "--enhc" || arg == "--peek") {
+            opt.rules.enhc = arg == "--enhc";
+            custom = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            opt.batch = std::atoi(argv[++i]); // Lockstep tables per thread
+        } else if (arg == "--simd" && i + 1 < argc) {
+            std::string nm = argv[++i]; // Widest kernel to use
+            auto it = std::find(std::begin(SIMDNM), std::end(SIMDNM), nm);
+            if (it == std::end(SIMDNM)) {
+                std::cerr << "--simd must be scalar, sse4.1 or avx2\n";
+                return 1;
+            }
+            opt.simd = static_cast<SimdLvl>(it - std::begin(SIMDNM));
+        } else if (arg == "--log" && i + 1 < argc) {
+            opt.logPath = argv[++i]; // Binary event log
+        } else if (arg == "--csv" && i + 2 < argc) {
+            csvIn = argv[++i]; // Event log to convert
+            csvOut = argv[++i]; // CSV to write
+        } else if (arg == "--index-search") {
+            idx = true; // Deviation indices for the rules and count
+        } else if (arg == "--dealer-probs") {
+            dlrPrb = true; // Analytic dealer table
+        } else if (arg == "--bench") {
+            bench = true; // Benchmark mode
+        } else if (arg == "--replay" && i + 1 < argc) {
+            const char* rp = argv[++i]; // TABLE:ROUND
+            char* end = nullptr;
+            opt.rpTbl = static_cast<int>(std::strtol(rp, &end, 10));
+            if (*end != ':' || opt.rpTbl < 0) {
+                std::cerr << "--replay must be TABLE:ROUND\n";
+                return 1;
+            }
+            opt.rpRnd = std::strtoll(end + 1, &end, 10);
+            if (*end != '\0' || opt.rpRnd < 1) {
+                std::cerr << "--replay must be TABLE:ROUND with ROUND from 1\n";
+                return 1;
+            }
+        } else if (arg == "--checkpoint" && i + 2 < argc) {
+            opt.ckPath = argv[++i]; // Checkpoint file
+            opt.ckEvery = std::atoll(argv[++i]); // Rounds per table between saves
+            if (opt.ckEvery < 1) {
+                std::cerr << "--checkpoint needs a positive round interval\n";
+                return 1;
+            }
+        } else if (arg == "--resume" && i + 1 < argc) {
+            opt.rsmPath = argv[++i]; // Checkpoint to continue
+        } else if (arg == "--record" && i + 1 < argc) {
+            opt.recPath = argv[++i]; // Replay file to write
+        } else if (arg == "--verify" && i + 2 < argc) {
+            opt.vfyPath = argv[++i]; // Replay file to check
+            opt.vfyRnd = std::atoll(argv[++i]); // Round to show, 0 for all
+            if (opt.vfyRnd < 0) {
+                std::cerr << "--verify needs a round from 1, or 0 for every round\n";
+                return 1;
+            }
+        } else if (arg == "--serve" && i + 1 < argc) {
+            opt.port = std::atoi(argv[++i]); // Game server port
+            if (opt.port < 1 || opt.port > 65535) {
+                std::cerr << "--serve needs a port between 1 and 65535\n";
+                return 1;
+            }
+        } else if (arg == "--prof") {
+            opt.prof = true; // Round profile at the end
+        } else if (arg == "--precision" && i + 1 < argc) {
+            opt.prec = std::atof(argv[++i]); // Target 95% half-width, % of the bet
+        } else if (arg == "--bankroll" && i + 1 < argc) {
+            opt.bankU = std::atoi(argv[++i]); // Units for the risk of ruin
+        } else if (arg == "--quiet") {
+            opt.quiet = true; // Prompts and summaries only
+        } else if (arg == "--nosync") {
+            noSync = true; // C++ streams buffer on their own
+        } else if (arg == "--shuffle-ahead") {
+            opt.shufAhd = true; // Background shuffler for simulated tables
+        } else if (arg == "--filter" && i + 1 < argc) {
+            bchFilt = argv[++i]; // Benchmark name filter
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--simulate N] [--players K] [--threads T] [--seed S] [--shuffle fy|legacy|csm] [--strategy basic|mimic|ev|count] [--count hilo|ko|omega2] [--rules standard|vegas|euro] [--decks N] [--pen P] [--h17|--s17] [--bj N:D] [--das|--nodas] [--splits N] [--surrender|--nosurrender] [--enhc|--peek] [--log FILE] [--csv LOG CSV] [--batch N] [--simd scalar|sse4.1|avx2] [--replay T:R] [--serve PORT] [--checkpoint FILE N] [--resume FILE] [--record FILE] [--verify FILE N] [--precision P] [--bankroll U] [--shuffle-ahead] [--quiet] [--nosync] [--prof] [--index-search] [--dealer-probs] [--bench [--filter NAME]]\n";
+            return 1;
+        }
+    }
+    if (opt.plyrs < 1 || opt.plyrs > MAXSEAT) { // Seats at a standard table
+        std::cerr << "--players must be between 1 and 7\n";
+        return 1;
+    }
+    if (opt.thrds < 1) { // Need at least one table
+        std::cerr << "--threads must be at least 1\n";
+        return 1;
+    }
+    if (opt.batch < 0 || (opt.batch > 0 && (opt.kind != StratKind::BASIC || !opt.logPath.empty() || opt.rpTbl >= 0 ||
+                                            opt.shufAlg == ShufAlg::CSM))) {
+        std::cerr << "--batch needs a positive table count, basic strategy, a cut-card shoe and no --log or --replay\n";
+        return 1;
+    }
+    if ((!opt.ckPath.empty() || !opt.rsmPath.empty()) && (opt.rnds < 1 || opt.batch > 0 || opt.rpTbl >= 0)) {
+        std::cerr << "--checkpoint and --resume need --simulate without --batch or --replay\n";
+        return 1;
+    }
+    if (opt.prec < 0 || opt.bankU < 1 || (opt.prec > 0 && (opt.rnds < 1 || opt.batch > 0 || opt.rpTbl >= 0))) {
+        std::cerr << "--precision needs --simulate without --batch or --replay, and --bankroll at least 1 unit\n";
+        return 1;
+    }
+    if (!opt.rsmPath.empty() && !opt.logPath.empty()) { // The log would start over mid-run
+        std::cerr << "--resume cannot be combined with --log\n";
+        return 1;
+    }
+    if (!opt.recPath.empty() && (opt.batch > 0 || opt.rpTbl >= 0 || !opt.rsmPath.empty() || opt.port > 0)) {
+        std::cerr << "--record needs play through playRnd: no --batch, --replay, --resume or --serve\n";
+        return 1;
+    }
+    if (!opt.recPath.empty() && rpMaxBet(opt.rules.bjNum) < SIMBANK) { // Any bet a seat can make must fit
+        std::cerr << "--record cannot hold the stakes of a " << opt.rules.bjNum << ":" << opt.rules.bjDen
+                  << " natural payout\n";
+        return 1;
+    }
+
     // Process/Calculations Here
+    if (noSync) std::ios::sync_with_stdio(false); // Before any console I/O
+    FrameBuf frm(std::cout); // Output goes out a frame at a time
     // Setting fixed point notation for chips display
     std::cout << std::fixed << std::setprecision(0);
 
-    runGame();
-    
+    try {
+        if (pen >= 0) opt.rules.cut = opt.rules.decks * DKSIZE * (100 - pen) / 100; // Cards behind the cut card
+        if (custom) opt.preset = -1; // Runs on the runtime RuleSet
+        chkRules(opt.rules);
+
+        if (bench) {
+            benchAll(bchFilt); // Engine hot-path timings
+        } else if (idx) {
+            runIdx(opt); // Count indices for the rules in use
+        } else if (dlrPrb) {
+            prntDlr(opt.rules.decks, opt.rules.h17); // The shoe and soft-17 rule in use
+        } else if (!csvIn.empty()) {
+            expCsv(csvIn, csvOut); // Event log to CSV
+        } else if (!opt.vfyPath.empty()) {
+            runVfy(opt); // Re-deal recorded rounds
+        } else if (opt.port > 0) {
+            runSrv(opt); // Network tables until killed
+        } else if (opt.rnds > 0 || opt.rpTbl >= 0) {
+            runSim(opt); // Headless Monte Carlo run, or one replayed round
+        } else {
+            runGame(opt);
+        }
+    } catch (const std::exception& e) { // Setup errors such as unopenable files
+        std::cerr << "ERROR: " << e.what() << "\n";
+        return 1;
+    }
+
     // Output Located Here
 
     // Exit